@@ -0,0 +1,368 @@
+// Frame pipeline microbenchmarks: `make bench`
+//
+// Small google-benchmark style harness so it builds without extra deps.
+// Each case reports ns per frame, heap allocations per frame and the frame
+// rate that cost would cap us at. Pass a substring to only run matching cases.
+
+#include "ledmgr.h"
+#include "led_matrix.h"
+#include "led_encode.h"
+#include "led_sinks.h"
+#include "rotating_orb_anim.h"
+#include "led_compositor.h"
+#include "led_frame_cache.h"
+#include "led_tx_cache.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+
+// ─── allocation counting ─────────────────────────────────────────
+static std::atomic<uint64_t> g_allocs{0};
+
+void* operator new(std::size_t size) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+// ─── harness ─────────────────────────────────────────────────────
+class BenchState {
+public:
+    explicit BenchState(uint64_t iterations) : remaining(iterations), iterations(iterations) {}
+    bool KeepRunning() { return remaining-- > 0; }
+    uint64_t Iterations() const { return iterations; }
+private:
+    uint64_t remaining;
+    uint64_t iterations;
+};
+
+struct BenchCase {
+    const char* name;
+    std::function<void(BenchState&)> fn;
+};
+
+static std::vector<BenchCase>& registry() {
+    static std::vector<BenchCase> cases;
+    return cases;
+}
+
+struct BenchRegistrar {
+    BenchRegistrar(const char* name, std::function<void(BenchState&)> fn) {
+        registry().push_back({name, std::move(fn)});
+    }
+};
+
+#define BENCHMARK(fn) static BenchRegistrar fn##_registrar(#fn, fn)
+
+template <typename T>
+static void DoNotOptimize(T const& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+static void run_case(const BenchCase& bench) {
+    using clock = std::chrono::steady_clock;
+    const double min_time_s = 0.5;
+
+    // grow the iteration count until a run is long enough to trust
+    uint64_t iters = 1;
+    double elapsed_s = 0.0;
+    uint64_t allocs = 0;
+    while (true) {
+        BenchState state(iters);
+        uint64_t allocs_before = g_allocs.load(std::memory_order_relaxed);
+        auto t0 = clock::now();
+        bench.fn(state);
+        auto t1 = clock::now();
+        allocs = g_allocs.load(std::memory_order_relaxed) - allocs_before;
+        elapsed_s = std::chrono::duration<double>(t1 - t0).count();
+        if (elapsed_s >= min_time_s || iters >= (1ull << 30)) break;
+        double scale = elapsed_s > 0.0 ? (min_time_s * 1.4) / elapsed_s : 100.0;
+        if (scale > 100.0) scale = 100.0;
+        if (scale < 2.0) scale = 2.0;
+        iters = static_cast<uint64_t>(iters * scale);
+    }
+
+    double ns = elapsed_s * 1e9 / static_cast<double>(iters);
+    double allocs_per = static_cast<double>(allocs) / static_cast<double>(iters);
+    printf("%-36s %12.1f %10.2f %14.0f %12llu\n", bench.name, ns, allocs_per,
+           ns > 0.0 ? 1e9 / ns : 0.0, static_cast<unsigned long long>(iters));
+}
+
+// ─── shared fixtures ─────────────────────────────────────────────
+// animations get synthetic time, one 50 fps frame per iteration
+static constexpr std::chrono::milliseconds FRAME_STEP{20};
+
+static LEDArray test_frame(uint32_t seed) {
+    LEDArray frame;
+    for (int i = 0; i < LED_COUNT; i++) {
+        uint32_t v = (seed + i) * 2654435761u;
+        frame[i] = { static_cast<uint8_t>(v >> 8), static_cast<uint8_t>(v >> 16), static_cast<uint8_t>(v >> 24) };
+    }
+    return frame;
+}
+
+// Manager wired to a null sink, frames go through the real output thread.
+struct NullPipeline {
+    tfw::LEDManager mgr;
+    null_sink_t* sink = nullptr;
+    uint64_t published = 1; // Initialize() publishes a blank frame
+
+    NullPipeline() {
+        auto s = std::make_unique<null_sink_t>();
+        sink = s.get();
+        mgr.Initialize(std::move(s));
+        mgr.SetKeepAlive(std::chrono::milliseconds(0));
+        wait_drained();
+    }
+    // blocks until the output thread has dealt with everything published so far,
+    // only valid when nothing got published while it was busy (one frame in flight)
+    void wait_drained() {
+        while (sink->Transfers() + mgr.SkippedFrames() < published) {}
+    }
+};
+
+// ─── encoder ─────────────────────────────────────────────────────
+static void BM_encode_color(BenchState& state) {
+    LEDArray frame = test_frame(1);
+    alignas(64) static char tx[LED_FRAME_BYTES];
+    while (state.KeepRunning()) {
+        for (int j = 0; j < LED_COUNT; j++) encode_color(frame[j], &tx[j * 24]);
+        DoNotOptimize(tx);
+    }
+}
+BENCHMARK(BM_encode_color);
+
+static void BM_encode_frame(BenchState& state) {
+    LEDArray frame = test_frame(2);
+    alignas(64) static char tx[LED_FRAME_BYTES];
+    while (state.KeepRunning()) {
+        encode_frame(frame, tx);
+        DoNotOptimize(tx);
+    }
+}
+BENCHMARK(BM_encode_frame);
+
+// a baked cycle coming back round: lookup only, the encoder never runs
+static void BM_tx_cache_hit(BenchState& state) {
+    LEDTxCache cache;
+    cache.Configure(LED_FRAME_BYTES, LED_TX_CACHE_DEFAULT_BUDGET);
+    std::vector<LEDArray> cycle;
+    for (uint32_t i = 0; i < 128; i++) cycle.push_back(test_frame(i * 7));
+    bool hit;
+    for (const LEDArray& frame : cycle) encode_frame(frame, cache.Get(frame, 1, hit));
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        const LEDArray& frame = cycle[i++ % cycle.size()];
+        char* tx = cache.Get(frame, 1, hit);
+        if (!hit) encode_frame(frame, tx);
+        DoNotOptimize(tx);
+    }
+}
+BENCHMARK(BM_tx_cache_hit);
+
+// ─── matrix ──────────────────────────────────────────────────────
+static void BM_LEDMatrix_Update(BenchState& state) {
+    LEDMatrix matrix;
+    LEDArray leds{};
+    while (state.KeepRunning()) {
+        matrix.Update(leds);
+        DoNotOptimize(leds);
+    }
+}
+BENCHMARK(BM_LEDMatrix_Update);
+
+static void BM_LEDMatrix_set_led_polar(BenchState& state) {
+    LEDMatrix matrix;
+    LEDArray leds{};
+    while (state.KeepRunning()) {
+        matrix.Clear(leds);
+        for (int i = 0; i < LED_COUNT; i++) matrix.set_led(led_polar[i], led_color_t{10, 20, 30});
+        DoNotOptimize(matrix);
+    }
+}
+BENCHMARK(BM_LEDMatrix_set_led_polar);
+
+// ─── output stage ────────────────────────────────────────────────
+static void BM_OutputStage_gamma_dither(BenchState& state) {
+    LEDOutputStage output;
+    output.SetGamma(2.2f);
+    LEDArray leds;
+    for (int i = 0; i < LED_COUNT; i++) leds[i] = {static_cast<uint8_t>(i * 4), 5, 10};
+    while (state.KeepRunning()) {
+        LEDArray frame = leds;
+        output.Apply(frame);
+        DoNotOptimize(frame);
+    }
+}
+BENCHMARK(BM_OutputStage_gamma_dither);
+
+// ─── animators ───────────────────────────────────────────────────
+static void BM_RotatingOrbAnimator(BenchState& state) {
+    tfw::RotatingOrbAnimator orb({240.0f, 1.0f, 1.0f}, {200, 200, 220}, 300.0f);
+    LEDArray leds{};
+    render_time_t t{};
+    while (state.KeepRunning()) {
+        orb.Render(t += FRAME_STEP, leds);
+        DoNotOptimize(leds);
+    }
+}
+BENCHMARK(BM_RotatingOrbAnimator);
+
+static void BM_Glow_Render(BenchState& state) {
+    LEDArray leds{};
+    Glow glow(5, led_color_t{40, 120, 255}, led_color_t{5, 5, 10});
+    render_time_t t{};
+    while (state.KeepRunning()) {
+        glow.Render(t += FRAME_STEP, leds);
+        DoNotOptimize(leds);
+    }
+}
+BENCHMARK(BM_Glow_Render);
+
+// same two played back out of their baked tables, the bake is done up front
+static void BM_RotatingOrb_cached(BenchState& state) {
+    LEDFrameCache cache;
+    CachedAnimation orb(std::make_shared<tfw::RotatingOrbAnimator>(HSV{240.0f, 1.0f, 1.0f}, led_color_t{200, 200, 220}, 300.0f), cache);
+    LEDArray leds{};
+    render_time_t t{};
+    orb.Render(t, leds);
+    while (state.KeepRunning()) {
+        orb.Render(t += FRAME_STEP, leds);
+        DoNotOptimize(leds);
+    }
+}
+BENCHMARK(BM_RotatingOrb_cached);
+
+static void BM_Glow_cached(BenchState& state) {
+    LEDFrameCache cache;
+    CachedAnimation glow(std::make_shared<Glow>(5, led_color_t{40, 120, 255}, led_color_t{5, 5, 10}), cache);
+    LEDArray leds{};
+    render_time_t t{};
+    glow.Render(t, leds);
+    while (state.KeepRunning()) {
+        glow.Render(t += FRAME_STEP, leds);
+        DoNotOptimize(leds);
+    }
+}
+BENCHMARK(BM_Glow_cached);
+
+// what a miss costs the render thread: one whole cycle baked, per iteration
+static void BM_RotatingOrb_bake(BenchState& state) {
+    LEDFrameCache cache;
+    tfw::RotatingOrbAnimator orb(HSV{240.0f, 1.0f, 1.0f}, led_color_t{200, 200, 220}, 300.0f);
+    render_time_t t{};
+    while (state.KeepRunning()) {
+        cache.Clear();
+        auto table = cache.Get(orb, t += FRAME_STEP);
+        DoNotOptimize(table);
+    }
+}
+BENCHMARK(BM_RotatingOrb_bake);
+
+static void BM_Loader_Render(BenchState& state) {
+    LEDArray leds{};
+    Loader loader({20, 150, 40}, 1000000);
+    render_time_t t{};
+    loader.Render(t, leds);
+    while (state.KeepRunning()) {
+        loader.Render(t, leds);     // same t: the trail stays put, only the drawing is timed
+        DoNotOptimize(leds);
+    }
+}
+BENCHMARK(BM_Loader_Render);
+
+static void BM_TransitionSpiral_Render(BenchState& state) {
+    LEDArray leds{};
+    TransitionSpiral spiral({HSV{0.f, 1.f, 1.f}, HSV{120.f, 1.f, 1.f}, HSV{240.f, 1.f, 1.f}},
+                            {HSV{30.f, 1.f, 1.f}, HSV{150.f, 1.f, 1.f}, HSV{270.f, 1.f, 1.f}});
+    render_time_t t{};
+    while (state.KeepRunning()) {
+        spiral.Render(t, leds);     // stays in its first phase
+        DoNotOptimize(leds);
+    }
+}
+BENCHMARK(BM_TransitionSpiral_Render);
+
+// ─── compositor ──────────────────────────────────────────────────
+static void BM_Compositor_loader_over_glow(BenchState& state) {
+    Glow glow(5, led_color_t{40, 120, 255}, led_color_t{5, 5, 10});
+    Loader loader({20, 150, 40}, 1000000);
+    LEDCompositor comp;
+    comp.AddLayer(glow, BlendMode::Alpha, 0.6f);
+    comp.AddLayer(loader, BlendMode::Alpha);
+    LEDArray out{};
+    render_time_t t{};
+    while (state.KeepRunning()) {
+        comp.Composite(t += FRAME_STEP, out);
+        DoNotOptimize(out);
+    }
+}
+BENCHMARK(BM_Compositor_loader_over_glow);
+
+// blend cost alone, one static layer per mode
+static void BM_Compositor_blend_modes(BenchState& state) {
+    const LEDArray frame = test_frame(3);
+    LEDCompositor comp;
+    for (BlendMode mode : {BlendMode::Add, BlendMode::Alpha, BlendMode::Max, BlendMode::Multiply, BlendMode::Screen})
+        comp.AddLayer([&frame](render_time_t, led_span_t out) { out.copy_from(frame); }, mode, 0.5f);
+    LEDArray out{};
+    while (state.KeepRunning()) {
+        comp.Composite(render_time_t{}, out);
+        DoNotOptimize(out);
+    }
+}
+BENCHMARK(BM_Compositor_blend_modes);
+
+// ─── end to end ──────────────────────────────────────────────────
+// render + compose + publish, then wait for encode + null transfer
+static void BM_full_frame_glow(BenchState& state) {
+    static NullPipeline pipeline;
+    Glow glow(5, led_color_t{40, 120, 255}, led_color_t{5, 5, 10});
+    render_time_t t{};
+    while (state.KeepRunning()) {
+        pipeline.mgr.RenderFrame(glow, t += FRAME_STEP);
+        ++pipeline.published;
+        pipeline.wait_drained();
+    }
+}
+BENCHMARK(BM_full_frame_glow);
+
+static void BM_full_frame_rotating_orb(BenchState& state) {
+    static NullPipeline pipeline;
+    tfw::RotatingOrbAnimator orb({30.0f, 1.0f, 1.0f}, {0, 0, 0});
+    render_time_t t{};
+    while (state.KeepRunning()) {
+        pipeline.mgr.RenderFrame(orb, t += FRAME_STEP);
+        ++pipeline.published;
+        pipeline.wait_drained();
+    }
+}
+BENCHMARK(BM_full_frame_rotating_orb);
+
+int main(int argc, char** argv) {
+    const char* filter = argc > 1 ? argv[1] : nullptr;
+    printf("encoder kernel: %s\n", encode_frame_kernel());
+    printf("%-36s %12s %10s %14s %12s\n", "benchmark", "ns/frame", "allocs/fr", "max fps", "iterations");
+    printf("%s\n", std::string(88, '-').c_str());
+    for (const auto& bench : registry()) {
+        if (filter && !std::strstr(bench.name, filter)) continue;
+        run_case(bench);
+    }
+    return 0;
+}
@@ -0,0 +1,131 @@
+#pragma once
+#include <cstdint>
+#include <cerrno>
+#include <atomic>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+/*
+absolute-deadline frame pacing.
+deadlines sit on a fixed grid (start + n * period) so render/spi time
+never accumulates into the frame period. if a frame overruns we skip
+ahead to the next grid slot instead of trying to catch up.
+WaitOrWake() lets another thread pull the next frame in early (e.g. a state
+change), the sleep is a futex so it's as precise as clock_nanosleep.
+*/
+
+#define FRAME_CLOCK_DEFAULT_FPS 50
+#define FRAME_CLOCK_MAX_FPS 1000
+#define FRAME_CLOCK_MIN_WAKE_NS 1000000   // early frames never come closer than this
+
+class FrameClock {
+public:
+    explicit FrameClock(uint32_t fps = FRAME_CLOCK_DEFAULT_FPS) {
+        SetFps(fps);
+        Reset();
+    }
+
+    void SetFps(uint32_t fps) {
+        if(fps == 0) fps = 1;
+        if(fps > FRAME_CLOCK_MAX_FPS) fps = FRAME_CLOCK_MAX_FPS;
+        this->fps.store(fps, std::memory_order_relaxed);
+        period_ns.store(1000000000ll / fps, std::memory_order_relaxed);
+    }
+    uint32_t Fps() const { return fps.load(std::memory_order_relaxed); }
+    int64_t PeriodNs() const { return period_ns.load(std::memory_order_relaxed); }
+
+    // Restarts the deadline grid at "now + one period".
+    void Reset() {
+        next_ns = now_ns() + PeriodNs();
+    }
+
+    // Sleeps until the next deadline. Returns how many deadlines were missed
+    // (0 when the frame finished in time).
+    uint32_t Wait() {
+        const int64_t period_ns = PeriodNs();
+        int64_t now = now_ns();
+        uint32_t skipped = 0;
+        if(now >= next_ns){
+            // overrun: drop the slots we already blew through, stay on the grid
+            skipped = static_cast<uint32_t>((now - next_ns) / period_ns) + 1;
+            next_ns += static_cast<int64_t>(skipped) * period_ns;
+            missed.fetch_add(skipped, std::memory_order_relaxed);
+        }
+        timespec ts = { static_cast<time_t>(next_ns / 1000000000ll),
+                        static_cast<long>(next_ns % 1000000000ll) };
+        while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {}
+        next_ns += period_ns;
+        frames.fetch_add(1, std::memory_order_relaxed);
+        return skipped;
+    }
+
+    // Same as Wait(), but returns early once `wake` gets set (see Wake()),
+    // clearing it. An early return doesn't use up the deadline, the next call
+    // still sleeps to the same grid slot. Returns true when woken early.
+    bool WaitOrWake(std::atomic<uint32_t>& wake) {
+        const int64_t period_ns = PeriodNs();
+        int64_t now = now_ns();
+        if(now >= next_ns){
+            uint32_t skipped = static_cast<uint32_t>((now - next_ns) / period_ns) + 1;
+            next_ns += static_cast<int64_t>(skipped) * period_ns;
+            missed.fetch_add(skipped, std::memory_order_relaxed);
+        }
+        timespec ts = { static_cast<time_t>(next_ns / 1000000000ll),
+                        static_cast<long>(next_ns % 1000000000ll) };
+        while(true){
+            if(wake.exchange(0, std::memory_order_acquire)){
+                // rate limit early frames so a flood of wakes can't spin the caller
+                int64_t earliest = last_return_ns + FRAME_CLOCK_MIN_WAKE_NS;
+                if(earliest < next_ns && now_ns() < earliest){
+                    timespec e = { static_cast<time_t>(earliest / 1000000000ll),
+                                   static_cast<long>(earliest % 1000000000ll) };
+                    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &e, nullptr) == EINTR) {}
+                }
+                if(now_ns() < next_ns){
+                    last_return_ns = now_ns();
+                    return true;
+                }
+                break;
+            }
+            // futex bitset waits take an absolute CLOCK_MONOTONIC timeout, same as clock_nanosleep
+            long r = syscall(SYS_futex, reinterpret_cast<uint32_t*>(&wake), FUTEX_WAIT_BITSET_PRIVATE,
+                             0u, &ts, nullptr, FUTEX_BITSET_MATCH_ANY);
+            if(r != 0 && errno == ETIMEDOUT) break;
+        }
+        next_ns += period_ns;
+        frames.fetch_add(1, std::memory_order_relaxed);
+        last_return_ns = now_ns();
+        return false;
+    }
+
+    // Cuts a WaitOrWake() on `wake` short. Any thread, cheap when already set.
+    static void Wake(std::atomic<uint32_t>& wake) {
+        if(wake.exchange(1, std::memory_order_release) == 0){
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(&wake), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+        }
+    }
+
+    uint64_t MissedDeadlines() const { return missed.load(std::memory_order_relaxed); }
+    uint64_t Frames() const { return frames.load(std::memory_order_relaxed); }
+    void ResetCounters() { missed.store(0); frames.store(0); }
+
+    static int64_t now_ns() {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000000ll + ts.tv_nsec;
+    }
+
+private:
+    // rate and counters may be touched from other threads, the deadline only by the waiter
+    std::atomic<uint32_t> fps{FRAME_CLOCK_DEFAULT_FPS};
+    std::atomic<int64_t> period_ns{1000000000ll / FRAME_CLOCK_DEFAULT_FPS};
+    int64_t next_ns = 0;
+    int64_t last_return_ns = 0;
+    std::atomic<uint64_t> missed{0};
+    std::atomic<uint64_t> frames{0};
+};
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) && std::atomic<uint32_t>::is_always_lock_free,
+              "WaitOrWake() futexes on the atomic directly");
@@ -0,0 +1,156 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <atomic>
+#include <array>
+#include <chrono>
+
+/*
+per-stage frame timing.
+every stage records into a lock-free log-linear histogram (16 buckets per
+power of two, so percentiles are within ~6%), recording is a couple of
+relaxed atomics so it's fine to leave on in production.
+*/
+
+enum class FrameStage : uint8_t {
+    Animate = 0,  // Animatable::Render into the back frame (fades and overlay included)
+    Output,       // output stage: ring gains, gamma, dithering
+    Render,       // whole render side of a frame, publish included
+    Encode,       // WS2812B encode (output thread)
+    Transfer,     // transport transfer / SPI ioctl (output thread)
+    Interval,     // time between published frames
+    Jitter,       // |interval - target period|
+    Count
+};
+
+inline const char* frame_stage_name(FrameStage stage) {
+    static const char* const names[] = { "animate", "output", "render",
+                                         "encode", "transfer", "interval", "jitter" };
+    return names[static_cast<int>(stage)];
+}
+
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BITS = 4;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BITS;
+    static constexpr int BUCKETS = 40 * SUB_BUCKETS; // up to ~2^43 ns
+
+    struct Summary {
+        uint64_t count = 0;
+        uint64_t p50_ns = 0;
+        uint64_t p99_ns = 0;
+        uint64_t max_ns = 0;
+        uint64_t mean_ns = 0;
+    };
+
+    void Record(uint64_t ns) {
+        buckets[bucket_of(ns)].fetch_add(1, std::memory_order_relaxed);
+        sum.fetch_add(ns, std::memory_order_relaxed);
+        uint64_t prev = max.load(std::memory_order_relaxed);
+        while (ns > prev && !max.compare_exchange_weak(prev, ns, std::memory_order_relaxed)) {}
+    }
+
+    Summary Summarize() const {
+        Summary s;
+        std::array<uint64_t, BUCKETS> snap;
+        for (int i = 0; i < BUCKETS; i++) {
+            snap[i] = buckets[i].load(std::memory_order_relaxed);
+            s.count += snap[i];
+        }
+        s.max_ns = max.load(std::memory_order_relaxed);
+        if (s.count == 0) return s;
+        s.mean_ns = sum.load(std::memory_order_relaxed) / s.count;
+        s.p50_ns = percentile(snap, s.count, 0.50, s.max_ns);
+        s.p99_ns = percentile(snap, s.count, 0.99, s.max_ns);
+        return s;
+    }
+
+    void Reset() {
+        for (auto& b : buckets) b.store(0, std::memory_order_relaxed);
+        sum.store(0, std::memory_order_relaxed);
+        max.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKETS> buckets{};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> max{0};
+
+    // values < SUB_BUCKETS get their own bucket, above that each power of two
+    // is split into SUB_BUCKETS linear steps
+    static int bucket_of(uint64_t ns) {
+        if (ns < SUB_BUCKETS) return static_cast<int>(ns);
+        int exp = 63 - __builtin_clzll(ns);                     // >= SUB_BITS
+        int sub = static_cast<int>((ns >> (exp - SUB_BITS)) & (SUB_BUCKETS - 1));
+        int idx = (exp - SUB_BITS + 1) * SUB_BUCKETS + sub;
+        return idx < BUCKETS ? idx : BUCKETS - 1;
+    }
+    // upper edge of a bucket
+    static uint64_t bucket_limit(int idx) {
+        if (idx < SUB_BUCKETS) return static_cast<uint64_t>(idx);
+        int exp = idx / SUB_BUCKETS + SUB_BITS - 1;
+        int sub = idx % SUB_BUCKETS;
+        return (static_cast<uint64_t>(SUB_BUCKETS + sub + 1) << (exp - SUB_BITS)) - 1;
+    }
+    static uint64_t percentile(const std::array<uint64_t, BUCKETS>& snap, uint64_t total,
+                               double q, uint64_t max_ns) {
+        uint64_t target = static_cast<uint64_t>(q * static_cast<double>(total));
+        if (target == 0) target = 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < BUCKETS; i++) {
+            seen += snap[i];
+            if (seen >= target) {
+                uint64_t limit = bucket_limit(i);
+                return limit < max_ns ? limit : max_ns;
+            }
+        }
+        return max_ns;
+    }
+};
+
+// Snapshot handed out by LEDManager::Stats().
+struct FrameStatsSnapshot {
+    std::array<LatencyHistogram::Summary, static_cast<int>(FrameStage::Count)> stages;
+    uint64_t frames = 0;           // frames published
+    uint64_t transmitted = 0;      // frames the output thread sent
+    uint64_t skipped = 0;          // unchanged frames not sent
+    uint64_t cached = 0;           // sent straight from the tx cache, not encoded
+    uint64_t missed_deadlines = 0;
+    uint32_t target_fps = 0;
+    double actual_fps = 0.0;       // from the mean frame interval since the last reset
+
+    const LatencyHistogram::Summary& operator[](FrameStage stage) const {
+        return stages[static_cast<int>(stage)];
+    }
+
+    void Print(FILE* out = stdout) const {
+        fprintf(out, "[LEDStats] fps %.2f (target %u) frames %llu sent %llu (cached %llu) unchanged %llu missed %llu\n",
+                actual_fps, target_fps,
+                static_cast<unsigned long long>(frames), static_cast<unsigned long long>(transmitted),
+                static_cast<unsigned long long>(cached), static_cast<unsigned long long>(skipped), static_cast<unsigned long long>(missed_deadlines));
+        fprintf(out, "[LEDStats] %-9s %10s %10s %10s %10s %10s\n", "stage", "count", "p50 us", "p99 us", "max us", "mean us");
+        for (int i = 0; i < static_cast<int>(FrameStage::Count); i++) {
+            const auto& s = stages[i];
+            if (s.count == 0) continue;
+            fprintf(out, "[LEDStats] %-9s %10llu %10.1f %10.1f %10.1f %10.1f\n",
+                    frame_stage_name(static_cast<FrameStage>(i)), static_cast<unsigned long long>(s.count),
+                    s.p50_ns / 1000.0, s.p99_ns / 1000.0, s.max_ns / 1000.0, s.mean_ns / 1000.0);
+        }
+        fflush(out);
+    }
+};
+
+// Scoped stage timer, records into the histogram when it goes out of scope.
+class StageTimer {
+public:
+    explicit StageTimer(LatencyHistogram* hist)
+        : hist(hist), t0(hist ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{}) {}
+    ~StageTimer() {
+        if (!hist) return;
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+        hist->Record(static_cast<uint64_t>(ns));
+    }
+private:
+    LatencyHistogram* hist;
+    std::chrono::steady_clock::time_point t0;
+};
@@ -0,0 +1,102 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <memory>
+#include <algorithm>
+
+#include "led_render.h"
+
+/*
+where render time comes from. LEDManager reads its AnimationClock once per
+frame and hands that t to every animation, fade and state timeout, so
+swapping the clock changes how fast (and how deterministically) the whole
+pipeline runs without touching an animation:
+  RealClock    the steady clock, what the daemon uses
+  ManualClock  only moves when told to. with a step it moves one step per
+               frame and frames stop waiting for the wall clock, so a
+               minute of animation renders as fast as the cpu allows,
+               same frames every run
+  ScaledClock  another clock sped up / slowed down, rate changes don't jump
+frame pacing, stats and the shm staleness check stay on the real clock.
+*/
+
+class AnimationClock {
+public:
+    virtual ~AnimationClock() = default;
+    // Any thread.
+    virtual render_time_t Now() const = 0;
+    // Render thread, after every frame. A stepping clock moves on here.
+    virtual void FrameDone() {}
+    // False: frames don't wait for their deadline, they render back to back.
+    virtual bool Paced() const { return true; }
+
+    int64_t NowNs() const { return render_time_ns(Now()); }
+};
+
+class RealClock : public AnimationClock {
+public:
+    render_time_t Now() const override { return render_clock::now(); }
+};
+
+class ManualClock : public AnimationClock {
+public:
+    // step: how far every rendered frame moves the clock, 0 = only Set()/Advance() do
+    explicit ManualClock(render_time_t start = render_time_t{}, render_clock::duration step = render_clock::duration::zero())
+        : now_ns(render_time_ns(start)), step_ns(std::chrono::duration_cast<std::chrono::nanoseconds>(step).count()) {}
+
+    render_time_t Now() const override { return render_time_from_ns(now_ns.load(std::memory_order_acquire)); }
+    void FrameDone() override { if (step_ns) now_ns.fetch_add(step_ns, std::memory_order_acq_rel); }
+    bool Paced() const override { return step_ns == 0; }
+
+    void Set(render_time_t t) { now_ns.store(render_time_ns(t), std::memory_order_release); }
+    void Advance(render_clock::duration d) {
+        now_ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count(), std::memory_order_acq_rel);
+    }
+
+private:
+    std::atomic<int64_t> now_ns;
+    const int64_t step_ns;
+};
+
+class ScaledClock : public AnimationClock {
+public:
+    // rate 2 = twice as fast as `base`, 0 = frozen
+    explicit ScaledClock(float rate = 1.0f, std::shared_ptr<AnimationClock> base = std::make_shared<RealClock>())
+        : base(std::move(base)), rate(std::max(0.0f, rate)) {
+        base_anchor = scaled_anchor = this->base->Now();
+    }
+
+    render_time_t Now() const override {
+        std::lock_guard<std::mutex> lock(mutex);
+        return scaled_at(base->Now());
+    }
+    void FrameDone() override { base->FrameDone(); }
+    bool Paced() const override { return base->Paced(); }
+
+    // Any thread. Time carries on from where it is, just at the new rate.
+    void SetRate(float r) {
+        std::lock_guard<std::mutex> lock(mutex);
+        render_time_t b = base->Now();
+        scaled_anchor = scaled_at(b);
+        base_anchor = b;
+        rate = std::max(0.0f, r);
+    }
+    float Rate() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return rate;
+    }
+
+private:
+    render_time_t scaled_at(render_time_t b) const {
+        auto elapsed = std::chrono::duration<double, std::nano>(b - base_anchor) * static_cast<double>(rate);
+        return scaled_anchor + std::chrono::duration_cast<render_clock::duration>(elapsed);
+    }
+
+    std::shared_ptr<AnimationClock> base;
+    mutable std::mutex mutex;     // SetRate() comes from control threads
+    render_time_t base_anchor;
+    render_time_t scaled_anchor;
+    float rate;
+};
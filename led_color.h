@@ -1,6 +1,8 @@
 #pragma once
 #include <cstdint>
+#include <cstring>
 #include <algorithm>
+#include <array>
 #include <cmath>
 #include <random> 
 #include <utility>
@@ -10,6 +12,7 @@
 #define WS2812B_SPI_SPEED 2500000
 #define WS2812B_HIGH 0b11100000  //  WS2812 "1"
 #define WS2812B_LOW  0b10000000  //  WS2812 "0"
+#define WS2812B_RESET_BYTES 96     //  low tail after each frame, >= 280us latch at 2.5Mbit/s
 
 #define DEFAULT_COLOR {128, 128, 128}
 
@@ -29,14 +32,8 @@ struct led_color_t {
     led_color_t operator-(const led_color_t& other) const {
         return { static_cast<uint8_t>(std::max(0, r - other.r)), static_cast<uint8_t>(std::max(0, g - other.g)), static_cast<uint8_t>(std::max(0, b - other.b)) };
     }
-    led_color_t operator*(float scalar) const {
-
-        return {
-            static_cast<uint8_t>(std::max(0.0f, std::min(255.0f, r * scalar))),
-            static_cast<uint8_t>(std::max(0.0f, std::min(255.0f, g * scalar))),
-            static_cast<uint8_t>(std::max(0.0f, std::min(255.0f, b * scalar)))
-        };
-    }
+    // scalar goes to Q8.8 once, the channels stay integer (see scale_q8)
+    led_color_t operator*(float scalar) const;
     led_color_t operator/(float scalar) const {
         return {
             static_cast<uint8_t>(std::max(0.0f, std::min(255.0f, r / scalar))),
@@ -79,18 +76,81 @@ struct led_color_t {
     }
 };
 
-inline void encode_color(uint8_t r, uint8_t g, uint8_t b, char* buffer) {
-    for (int i = 0; i < 8; i++) {
-        buffer[i] = (g & (1 << (7 - i))) ? WS2812B_HIGH : WS2812B_LOW;
-        buffer[8 + i] = (r & (1 << (7 - i))) ? WS2812B_HIGH : WS2812B_LOW;
-        buffer[16 + i] = (b & (1 << (7 - i))) ? WS2812B_HIGH : WS2812B_LOW;
+using LEDArray = std::array<led_color_t, LED_COUNT>;
+
+// Q8.8 fixed point for weights, gains and opacities: 256 = 1.0, up to
+// ~256x. floats get converted once when a parameter is set (or once per led
+// for falloff weights), every per channel operation after that is integer
+// only, which is what the little cores and the vector units like.
+using q8_t = uint16_t;
+#define Q8_ONE 256
+
+inline constexpr q8_t q8(float v) {
+    return v <= 0.0f ? 0 : v >= 255.99f ? 65535 : static_cast<q8_t>(v * 256.0f + 0.5f);
+}
+inline constexpr float q8_to_float(q8_t w) { return w * (1.0f / 256.0f); }
+
+// 8 bit channel times a Q8.8 weight, saturating
+inline uint8_t scale_q8(uint8_t c, uint32_t w) {
+    uint32_t v = (c * w + 128) >> 8;
+    return static_cast<uint8_t>(v > 255 ? 255 : v);
+}
+inline led_color_t scale_q8(const led_color_t& c, uint32_t w) {
+    return { scale_q8(c.r, w), scale_q8(c.g, w), scale_q8(c.b, w) };
+}
+// a + (b - a) * t, t in [0, Q8_ONE]
+inline uint8_t lerp_q8(uint8_t a, uint8_t b, uint32_t t) {
+    return static_cast<uint8_t>((a * (Q8_ONE - t) + b * t + 128) >> 8);
+}
+inline led_color_t lerp_q8(const led_color_t& a, const led_color_t& b, uint32_t t) {
+    return { lerp_q8(a.r, b.r, t), lerp_q8(a.g, b.g, t), lerp_q8(a.b, b.b, t) };
+}
+// out = in * w for a run of packed channels, in place is fine
+inline void scale_channels_q8(const uint8_t* in, int count, uint32_t w, uint8_t* out) {
+    for (int i = 0; i < count; ++i) {
+        uint32_t v = (in[i] * w + 128) >> 8;
+        out[i] = static_cast<uint8_t>(v > 255 ? 255 : v);
     }
 }
+
+inline led_color_t led_color_t::operator*(float scalar) const {
+    return scale_q8(*this, q8(scalar));
+}
+
+// WS2812B symbols for every channel value, built at compile time.
+// byte k (in memory order) is the symbol for bit 7-k, msb goes out first,
+// so a whole channel is a single 64-bit store.
+inline constexpr std::array<uint64_t, 256> make_ws2812b_lut() {
+    std::array<uint64_t, 256> lut{};
+    for (int v = 0; v < 256; v++) {
+        uint64_t word = 0;
+        for (int k = 0; k < 8; k++) {
+            uint64_t sym = (v & (1 << (7 - k))) ? WS2812B_HIGH : WS2812B_LOW;
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            word |= sym << (8 * (7 - k));
+#else
+            word |= sym << (8 * k);
+#endif
+        }
+        lut[v] = word;
+    }
+    return lut;
+}
+inline constexpr std::array<uint64_t, 256> ws2812b_lut = make_ws2812b_lut();
+
+inline void encode_color(uint8_t r, uint8_t g, uint8_t b, char* buffer) {
+    std::memcpy(buffer,      &ws2812b_lut[g], 8);
+    std::memcpy(buffer + 8,  &ws2812b_lut[r], 8);
+    std::memcpy(buffer + 16, &ws2812b_lut[b], 8);
+}
 inline void encode_color(const led_color_t& c, char* buffer) {
-    for (int i = 0; i < 8; i++) {
-        buffer[i] = (c.g & (1 << (7 - i))) ? WS2812B_HIGH : WS2812B_LOW;
-        buffer[8 + i] = (c.r & (1 << (7 - i))) ? WS2812B_HIGH : WS2812B_LOW;
-        buffer[16 + i] = (c.b & (1 << (7 - i))) ? WS2812B_HIGH : WS2812B_LOW;
+    encode_color(c.r, c.g, c.b, buffer);
+}
+// encodes `count` leds (24 bytes each) into buffer, every byte gets written
+// so it can be reused frame to frame without clearing
+inline void encode_leds(const led_color_t* leds, int count, char* buffer) {
+    for (int j = 0; j < count; j++) {
+        encode_color(leds[j], buffer + j * 24);
     }
 }
 
@@ -123,6 +183,20 @@ inline led_color_t hsv2rgb(const HSV& hsv) {
     return { R, G, B };
 }
 
+inline HSV rgb2hsv(const led_color_t& c) {
+    float r = c.r / 255.0f, g = c.g / 255.0f, b = c.b / 255.0f;
+    float mx = std::max(r, std::max(g, b));
+    float mn = std::min(r, std::min(g, b));
+    float d = mx - mn;
+    float h = 0.0f;
+    if (d > 0.0f) {
+        if (mx == r)      h = 60.0f * std::fmod((g - b) / d, 6.0f);
+        else if (mx == g) h = 60.0f * ((b - r) / d + 2.0f);
+        else              h = 60.0f * ((r - g) / d + 4.0f);
+        if (h < 0.0f) h += 360.0f;
+    }
+    return { h, mx > 0.0f ? d / mx : 0.0f, mx };
+}
 
 inline uint8_t generate_random_uint8() {
     static std::random_device rd;
@@ -151,3 +225,34 @@ inline float easeInOut(float t) {
 inline float mixf(float a, float b, float t) {
     return a + (b - a) * t;
 }
+
+// easing curves for transitions, t in [0,1]
+enum class EaseCurve : uint8_t {
+    Linear,
+    InOut,      // easeInOut, cosine
+    In,         // quadratic, slow start
+    Out,        // quadratic, slow end
+    Smooth,     // smoothstep
+};
+
+inline float ease(EaseCurve curve, float t) {
+    t = std::min(1.0f, std::max(0.0f, t));
+    switch (curve) {
+    case EaseCurve::Linear: return t;
+    case EaseCurve::InOut:  return easeInOut(t);
+    case EaseCurve::In:     return t * t;
+    case EaseCurve::Out:    return t * (2.0f - t);
+    case EaseCurve::Smooth: return t * t * (3.0f - 2.0f * t);
+    }
+    return t;
+}
+
+// blends two frames, t = 0 gives a, t = 1 gives b
+inline void mix_frames(const LEDArray& a, const LEDArray& b, float t, LEDArray& out) {
+    const uint32_t w = std::min<q8_t>(q8(t), Q8_ONE);
+    const uint8_t* pa = &a[0].r;
+    const uint8_t* pb = &b[0].r;
+    uint8_t* po = &out[0].r;
+    for (int i = 0; i < LED_COUNT * 3; ++i)
+        po[i] = lerp_q8(pa[i], pb[i], w);
+}
@@ -0,0 +1,149 @@
+#pragma once
+#include <vector>
+#include <array>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <cstdint>
+
+#include "led_color.h"
+#include "led_matrix.h"
+
+/*
+layered compositor.
+every layer renders a full frame (strip order, linear colours), the
+layers get blended bottom to top into a Q8.8 accumulator (integer only,
+opacity is converted when it's set) and the result is written out once. a
+layer is just a function rendering a frame for time t, so anything can
+feed it, an Animatable, a static colour, a frame from another process...
+the compositor is an Animatable itself so it nests and plays like any
+other.
+*/
+
+enum class BlendMode : uint8_t {
+    Add,        // dst + src, saturates
+    Alpha,      // src over dst, black is transparent (alpha = brightest channel)
+    Max,        // per channel max
+    Multiply,   // dst * src, darkens
+    Screen,     // 1 - (1 - dst)(1 - src), lightens
+};
+
+inline const char* blend_mode_name(BlendMode mode) {
+    static const char* const names[] = { "add", "alpha", "max", "multiply", "screen" };
+    return names[static_cast<int>(mode)];
+}
+
+class LEDCompositor : public Animatable {
+public:
+    using layer_source_fn = std::function<void(render_time_t t, led_span_t out)>;
+
+    // Adds a layer on top, returns its id. `source` has to fill every led.
+    int AddLayer(layer_source_fn source, BlendMode mode = BlendMode::Alpha, float opacity = 1.0f) {
+        layers.push_back({std::move(source), mode, clamp01(opacity), opacity_q8(opacity), true});
+        return static_cast<int>(layers.size()) - 1;
+    }
+
+    // Adds an animation as a layer. The animation has to outlive the compositor.
+    int AddLayer(Animatable& animation, BlendMode mode = BlendMode::Alpha, float opacity = 1.0f) {
+        return AddLayer([&animation](render_time_t t, led_span_t out) { animation.Render(t, out); }, mode, opacity);
+    }
+
+    // Same, but the layer keeps the animation alive.
+    int AddLayer(std::shared_ptr<Animatable> animation, BlendMode mode = BlendMode::Alpha, float opacity = 1.0f) {
+        return AddLayer([animation](render_time_t t, led_span_t out) { animation->Render(t, out); }, mode, opacity);
+    }
+
+    void SetOpacity(int id, float opacity) {
+        layer_t& layer = layers.at(id);
+        layer.opacity = clamp01(opacity);
+        layer.op = opacity_q8(opacity);
+    }
+    void SetBlendMode(int id, BlendMode mode) { layers.at(id).mode = mode; }
+    void SetVisible(int id, bool visible) { layers.at(id).visible = visible; }
+    float Opacity(int id) const { return layers.at(id).opacity; }
+    int LayerCount() const { return static_cast<int>(layers.size()); }
+
+    // Renders every visible layer for time t and blends them into `out`.
+    void Composite(render_time_t t, led_span_t out) {
+        accum.fill(0);
+        for (auto& layer : layers) {
+            if (!layer.visible || layer.op == 0) continue;
+            layer.source(t, scratch);
+            blend(layer);
+        }
+        // one pass back to 8 bit
+        uint8_t* dst = &out[0].r;
+        for (int i = 0; i < LED_COUNT * 3; ++i)
+            dst[i] = static_cast<uint8_t>((accum[i] + 128) >> 8);
+    }
+
+    void Render(render_time_t t, led_span_t out) override { Composite(t, out); }
+
+private:
+    struct layer_t {
+        layer_source_fn source;
+        BlendMode mode;
+        float opacity;
+        uint32_t op;        // opacity in Q8.8, 0..256
+        bool visible;
+    };
+
+    static float clamp01(float v) { return std::min(1.0f, std::max(0.0f, v)); }
+    static uint32_t opacity_q8(float v) { return q8(clamp01(v)); }
+    // a * b / 255 for two 8.8 / 8 bit values, exact enough for 8 bit output
+    static int32_t mul255(int32_t a, int32_t b) { return (a * b + 127) / 255; }
+
+    // blends scratch into accum. channels are 0..255 in Q8.8 (max 0xff00),
+    // everything but add stays in range on its own
+    void blend(const layer_t& layer) {
+        const int32_t op = static_cast<int32_t>(layer.op);
+        const int32_t full = 255 << 8;
+        const uint8_t* src = &scratch[0].r;
+        uint16_t* acc = accum.data();
+        switch (layer.mode) {
+        case BlendMode::Add:
+            for (int i = 0; i < LED_COUNT * 3; ++i)
+                acc[i] = static_cast<uint16_t>(std::min(full, acc[i] + src[i] * op));
+            break;
+        case BlendMode::Alpha:
+            for (int i = 0; i < LED_COUNT; ++i) {
+                const led_color_t& c = scratch[i];
+                // alpha in Q8.8, 0..256
+                int32_t a = mul255(std::max(c.r, std::max(c.g, c.b)), op);
+                if (a == 0) continue;
+                // src is premultiplied by its own brightness already
+                for (int k = 0; k < 3; ++k) {
+                    int32_t d = acc[i * 3 + k];
+                    acc[i * 3 + k] = static_cast<uint16_t>(std::min(full, src[i * 3 + k] * op + ((d * (Q8_ONE - a) + 128) >> 8)));
+                }
+            }
+            break;
+        case BlendMode::Max:
+            for (int i = 0; i < LED_COUNT * 3; ++i) {
+                int32_t d = acc[i];
+                int32_t m = std::max(d, src[i] << 8);
+                acc[i] = static_cast<uint16_t>(d + (((m - d) * op + 128) >> 8));
+            }
+            break;
+        case BlendMode::Multiply:
+            for (int i = 0; i < LED_COUNT * 3; ++i) {
+                int32_t d = acc[i];
+                acc[i] = static_cast<uint16_t>(d + (((mul255(d, src[i]) - d) * op) >> 8));
+            }
+            break;
+        case BlendMode::Screen:
+            for (int i = 0; i < LED_COUNT * 3; ++i) {
+                int32_t d = acc[i];
+                int32_t v = std::min(full, d + (src[i] << 8) - mul255(d, src[i]));
+                acc[i] = static_cast<uint16_t>(d + (((v - d) * op + 128) >> 8));
+            }
+            break;
+        }
+    }
+
+    std::vector<layer_t> layers;
+    std::array<uint16_t, LED_COUNT * 3> accum{};
+    LEDArray scratch{};
+};
+
+static_assert(sizeof(LEDArray) == LED_COUNT * 3, "compositor walks LEDArray as packed rgb bytes");
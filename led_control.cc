@@ -0,0 +1,308 @@
+#include "led_control.h"
+#include "ledmgr.h"
+#include "led_state_machine.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <sstream>
+#include <stddef.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+
+namespace tfw {
+
+// "@name" goes in the abstract namespace, anything else is a filesystem path
+static socklen_t make_unix_addr(const std::string& path, sockaddr_un& addr) {
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    size_t len = std::min(path.size(), sizeof(addr.sun_path) - 1);
+    std::memcpy(addr.sun_path, path.data(), len);
+    if (!path.empty() && path[0] == '@') {
+        addr.sun_path[0] = '\0';
+        return static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + len);
+    }
+    return static_cast<socklen_t>(sizeof(addr));
+}
+
+bool LEDControlServer::Start(const std::string& path) {
+    if (thread.joinable()) return true;
+    this->path = path;
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0) {
+        printf("[LEDControl] Error: socket failed (%s) \n", std::strerror(errno));
+        return false;
+    }
+    sockaddr_un addr;
+    socklen_t addr_len = make_unix_addr(path, addr);
+    if (path[0] != '@') unlink(path.c_str());
+    if (bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), addr_len) < 0 || listen(listen_fd, 16) < 0) {
+        printf("[LEDControl] Error: failed to listen on '%s' (%s) \n", path.c_str(), std::strerror(errno));
+        Stop();
+        return false;
+    }
+    // other users' processes on the device drive the leds too
+    if (path[0] != '@') chmod(path.c_str(), 0666);
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd < 0 || stop_fd < 0) {
+        printf("[LEDControl] Error: epoll setup failed (%s) \n", std::strerror(errno));
+        Stop();
+        return false;
+    }
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = listen_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev);
+    ev.data.fd = stop_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, stop_fd, &ev);
+
+    thread = std::thread(&LEDControlServer::loop, this);
+    printf("[LEDControl] Listening on '%s' \n", path.c_str());
+    return true;
+}
+
+void LEDControlServer::Stop() {
+    if (thread.joinable()) {
+        uint64_t one = 1;
+        ssize_t n = write(stop_fd, &one, sizeof(one));
+        (void)n;
+        thread.join();
+    }
+    for (auto& c : clients) close(c.first);
+    clients.clear();
+    if (listen_fd >= 0) {
+        close(listen_fd);
+        if (!path.empty() && path[0] != '@') unlink(path.c_str());
+    }
+    if (epoll_fd >= 0) close(epoll_fd);
+    if (stop_fd >= 0) close(stop_fd);
+    listen_fd = epoll_fd = stop_fd = -1;
+}
+
+void LEDControlServer::loop() {
+    epoll_event events[32];
+    while (true) {
+        int n = epoll_wait(epoll_fd, events, 32, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            printf("[LEDControl] Error: epoll_wait failed (%s) \n", std::strerror(errno));
+            return;
+        }
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            if (fd == stop_fd) return;
+            if (fd == listen_fd) {
+                accept_clients();
+                continue;
+            }
+            auto it = clients.find(fd);
+            if (it == clients.end()) continue;
+            bool keep = true;
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) keep = read_client(fd, it->second);
+            if (keep && (events[i].events & EPOLLOUT)) keep = flush_client(fd, it->second);
+            if (!keep) close_client(fd);
+        }
+    }
+}
+
+void LEDControlServer::accept_clients() {
+    while (true) {
+        int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return; // EAGAIN, or the client already went away
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+        clients[fd] = client_t{};
+    }
+}
+
+bool LEDControlServer::read_client(int fd, client_t& client) {
+    char buf[1024];
+    bool eof = false;
+    while (true) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n == 0) {
+            // the client is done writing, still answer what it sent
+            eof = true;
+            break;
+        }
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return false;
+        }
+        client.in.append(buf, static_cast<size_t>(n));
+    }
+    size_t start = 0, nl;
+    while ((nl = client.in.find('\n', start)) != std::string::npos) {
+        std::string line = client.in.substr(start, nl - start);
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        start = nl + 1;
+        if (line.empty()) continue;
+        client.out += handle(line);
+    }
+    client.in.erase(0, start);
+    if (client.in.size() > LED_CONTROL_MAX_LINE) {
+        client.out += "err line too long\n";
+        flush_client(fd, client);
+        return false;
+    }
+    if (eof) {
+        flush_client(fd, client);
+        return false;
+    }
+    return flush_client(fd, client);
+}
+
+bool LEDControlServer::flush_client(int fd, client_t& client) {
+    while (!client.out.empty()) {
+        ssize_t n = send(fd, client.out.data(), client.out.size(), MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return false;
+        }
+        client.out.erase(0, static_cast<size_t>(n));
+    }
+    // only ask for EPOLLOUT while there's something left to send
+    epoll_event ev{};
+    ev.events = EPOLLIN | (client.out.empty() ? 0u : static_cast<uint32_t>(EPOLLOUT));
+    ev.data.fd = fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev);
+    return true;
+}
+
+void LEDControlServer::close_client(int fd) {
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    clients.erase(fd);
+}
+
+// speed / color / timeout options after the state name
+static bool parse_params(std::istringstream& in, LEDStateParams& params, std::string& error) {
+    std::string key;
+    while (in >> key) {
+        std::string value;
+        if (!(in >> value)) {
+            error = "missing value for " + key;
+            return false;
+        }
+        char* end = nullptr;
+        if (key == "speed") {
+            params.speed = std::strtof(value.c_str(), &end);
+        } else if (key == "color") {
+            if (!value.empty() && value[0] == '#') value.erase(0, 1);
+            unsigned long rgb = std::strtoul(value.c_str(), &end, 16);
+            if (value.size() != 6) end = nullptr;
+            params.has_color = true;
+            params.color = { static_cast<uint8_t>(rgb >> 16), static_cast<uint8_t>(rgb >> 8), static_cast<uint8_t>(rgb) };
+        } else if (key == "timeout") {
+            params.timeout = std::chrono::milliseconds(std::strtol(value.c_str(), &end, 10));
+        } else {
+            error = "unknown option " + key;
+            return false;
+        }
+        if (!end || *end != '\0') {
+            error = "bad value for " + key;
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string LEDControlServer::handle(const std::string& line) {
+    commands.fetch_add(1, std::memory_order_relaxed);
+    std::istringstream in(line);
+    std::string cmd, arg, error;
+    in >> cmd;
+
+    if (cmd == "ping") return "ok pong\n";
+    if (cmd == "get") return std::string("ok ") + led_state_name(states.State()) + "\n";
+
+    if (cmd == "state" || cmd == "param") {
+        LEDState state;
+        if (!(in >> arg) || !led_state_from_name(arg.c_str(), state)) return "err unknown state\n";
+        LEDStateParams params;
+        if (!parse_params(in, params, error)) return "err " + error + "\n";
+        if (cmd == "state") states.SetState(state, params);
+        else states.SetParams(state, params);
+        return "ok\n";
+    }
+    if (cmd == "key") {
+        states.Keystroke();
+        return "ok\n";
+    }
+    if (cmd == "clear") {
+        if (!(in >> arg)) return "err clear what\n";
+        if (arg == "all") {
+            states.ClearAll();
+            return "ok\n";
+        }
+        LEDState state;
+        if (!led_state_from_name(arg.c_str(), state)) return "err unknown state\n";
+        states.ClearState(state);
+        return "ok\n";
+    }
+    if (cmd == "fade") {
+        long ms;
+        if (!(in >> ms) || ms < 0) return "err bad fade\n";
+        states.SetFade(std::chrono::milliseconds(ms));
+        return "ok\n";
+    }
+    if (cmd == "output") {
+        LEDOutputStage& output = mgr.Output();
+        std::string what;
+        if (!(in >> what)) {
+            char buf[160];
+            snprintf(buf, sizeof(buf), "ok brightness %.2f gamma %.2f dither %s gains %.2f %.2f %.2f %.2f %.2f\n", output.Brightness(),
+                     output.Gamma(), output.Dither() ? "on" : "off", output.RingGain(0), output.RingGain(1), output.RingGain(2),
+                     output.RingGain(3), output.RingGain(4));
+            return buf;
+        }
+        if (what == "gamma") {
+            float g;
+            if (!(in >> g) || g <= 0.0f) return "err bad gamma\n";
+            output.SetGamma(g);
+        } else if (what == "brightness") {
+            float b;
+            if (!(in >> b) || b < 0.0f || b > 1.0f) return "err brightness 0..1\n";
+            output.SetBrightness(b);
+        } else if (what == "gain") {
+            int ring;
+            float g;
+            if (!(in >> ring >> g) || ring < 0 || ring >= 5 || g < 0.0f) return "err bad gain\n";
+            output.SetRingGain(ring, g);
+        } else if (what == "dither") {
+            if (!(in >> arg) || (arg != "on" && arg != "off")) return "err dither on|off\n";
+            output.SetDither(arg == "on");
+        } else {
+            return "err unknown output option\n";
+        }
+        mgr.RequestFrame();
+        return "ok\n";
+    }
+    if (cmd == "stats") {
+        char* buf = nullptr;
+        size_t len = 0;
+        FILE* mem = open_memstream(&buf, &len);
+        if (!mem) return "err out of memory\n";
+        mgr.Stats().Print(mem);
+        fclose(mem);
+        std::string reply(buf, len);
+        free(buf);
+        if (in >> arg && arg == "reset") mgr.ResetStats();
+        return reply + "ok\n";
+    }
+    return "err unknown command\n";
+}
+
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <atomic>
+
+/*
+local control socket for the led daemon.
+a unix stream socket ("@name" = abstract namespace) speaking a line protocol,
+one command per line, every command gets exactly one reply line starting with
+"ok" or "err" (stats sends its table first, then "ok"):
+
+    state <name> [speed <deg/s>] [color <rrggbb>] [timeout <ms>]
+    param <name> [speed <deg/s>] [color <rrggbb>]
+    clear <name>|all
+    key                 (one keystroke: renews typing, the orb follows the key rate)
+    fade <ms>
+    output [brightness <0..1> | gamma <g> | gain <ring> <g> | dither on|off]   (no option: prints them)
+    get
+    stats [reset]
+    ping
+
+the socket runs on its own epoll thread, commands only touch the state
+machine's atomics and kick the render thread, so it never waits on a frame.
+*/
+
+#define LED_CONTROL_DEFAULT_SOCKET "@tfw-leds"
+#define LED_CONTROL_MAX_LINE 512
+
+namespace tfw {
+
+class LEDManager;
+class LEDStateMachine;
+
+class LEDControlServer {
+public:
+    LEDControlServer(LEDManager& mgr, LEDStateMachine& states) : mgr(mgr), states(states) {}
+    ~LEDControlServer() { Stop(); }
+
+    // Binds the socket and starts the epoll thread. Returns false on failure.
+    bool Start(const std::string& path = LED_CONTROL_DEFAULT_SOCKET);
+    void Stop();
+
+    uint64_t CommandsHandled() const { return commands.load(std::memory_order_relaxed); }
+
+private:
+    struct client_t {
+        std::string in;
+        std::string out;
+    };
+
+    void loop();
+    void accept_clients();
+    // false when the client should be dropped
+    bool read_client(int fd, client_t& client);
+    bool flush_client(int fd, client_t& client);
+    void close_client(int fd);
+    std::string handle(const std::string& line);
+
+    LEDManager& mgr;
+    LEDStateMachine& states;
+    std::string path;
+    int listen_fd = -1;
+    int epoll_fd = -1;
+    int stop_fd = -1;          // eventfd, wakes the loop for Stop()
+    std::thread thread;
+    std::unordered_map<int, client_t> clients;
+    std::atomic<uint64_t> commands{0};
+};
+
+}
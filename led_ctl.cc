@@ -0,0 +1,104 @@
+// led_ctl: command line client for the led daemon (led_demo --daemon)
+//
+//   led_ctl state typing speed 240
+//   led_ctl -s /run/leds.sock stats
+//   echo -e "state error\nget" | led_ctl
+//
+// With no command it reads commands from stdin, one per line. -t prints the
+// round trip time of every command.
+
+#include "led_control.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <iostream>
+#include <stddef.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+static int connect_socket(const std::string& path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    size_t len = std::min(path.size(), sizeof(addr.sun_path) - 1);
+    std::memcpy(addr.sun_path, path.data(), len);
+    socklen_t addr_len = sizeof(addr);
+    if (path[0] == '@') {
+        addr.sun_path[0] = '\0';
+        addr_len = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + len);
+    }
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), addr_len) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// sends one command and prints everything up to its ok/err line
+static bool run_command(int fd, const std::string& cmd, std::string& pending, bool timing) {
+    auto t0 = std::chrono::steady_clock::now();
+    std::string line = cmd + "\n";
+    if (send(fd, line.data(), line.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(line.size())) return false;
+    while (true) {
+        size_t nl;
+        while ((nl = pending.find('\n')) != std::string::npos) {
+            std::string reply = pending.substr(0, nl);
+            pending.erase(0, nl + 1);
+            bool last = reply.compare(0, 2, "ok") == 0 || reply.compare(0, 3, "err") == 0;
+            if (last && timing) {
+                double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+                printf("%s (%.0f us)\n", reply.c_str(), us);
+            } else {
+                printf("%s\n", reply.c_str());
+            }
+            if (last) return reply.compare(0, 2, "ok") == 0;
+        }
+        char buf[1024];
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        pending.append(buf, static_cast<size_t>(n));
+    }
+}
+
+int main(int argc, char** argv) {
+    std::string path = LED_CONTROL_DEFAULT_SOCKET;
+    bool timing = false;
+    int arg = 1;
+    for (; arg < argc; arg++) {
+        if (std::strcmp(argv[arg], "-s") == 0 && arg + 1 < argc) path = argv[++arg];
+        else if (std::strcmp(argv[arg], "-t") == 0) timing = true;
+        else break;
+    }
+
+    int fd = connect_socket(path);
+    if (fd < 0) {
+        fprintf(stderr, "[led_ctl] Error: can't connect to '%s' (%s)\n", path.c_str(), std::strerror(errno));
+        return 1;
+    }
+
+    std::string pending;
+    bool ok = true;
+    if (arg < argc) {
+        std::string cmd;
+        for (; arg < argc; arg++) {
+            if (!cmd.empty()) cmd += ' ';
+            cmd += argv[arg];
+        }
+        ok = run_command(fd, cmd, pending, timing);
+    } else {
+        std::string cmd;
+        while (std::getline(std::cin, cmd)) {
+            if (cmd.empty()) continue;
+            ok = run_command(fd, cmd, pending, timing) && ok;
+        }
+    }
+    close(fd);
+    return ok ? 0 : 1;
+}
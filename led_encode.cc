@@ -0,0 +1,185 @@
+#include "led_encode.h"
+
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LED_ENCODE_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#define LED_ENCODE_NEON 1
+#endif
+
+static void encode_scalar(const uint8_t* ch, size_t n, char* out) {
+    for (size_t i = 0; i < n; i++) {
+        std::memcpy(out + i * 8, &ws2812b_lut[ch[i]], 8);
+    }
+}
+
+#if LED_ENCODE_X86
+
+// bit tested by each output byte: byte k of a channel carries bit 7-k
+#define ENCODE_BITS_16 0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01, \
+                       0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01
+
+__attribute__((target("sse2")))
+static void encode_sse2(const uint8_t* ch, size_t n, char* out) {
+    const __m128i bits = _mm_setr_epi8(ENCODE_BITS_16);
+    const __m128i low  = _mm_set1_epi8(static_cast<char>(WS2812B_LOW));
+    const __m128i diff = _mm_set1_epi8(static_cast<char>(WS2812B_HIGH ^ WS2812B_LOW));
+
+    // v holds two channel bytes replicated 8x each
+    auto expand = [&](__m128i v, char* dst) {
+        __m128i set = _mm_cmpeq_epi8(_mm_and_si128(v, bits), bits);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst),
+                         _mm_xor_si128(low, _mm_and_si128(set, diff)));
+    };
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ch + i));
+        char* dst  = out + i * 8;
+        // no pshufb in sse2, replicate with unpacks: x2 -> x4 -> x8
+        __m128i lo = _mm_unpacklo_epi8(x, x);
+        __m128i hi = _mm_unpackhi_epi8(x, x);
+        __m128i q0 = _mm_unpacklo_epi16(lo, lo);
+        __m128i q1 = _mm_unpackhi_epi16(lo, lo);
+        __m128i q2 = _mm_unpacklo_epi16(hi, hi);
+        __m128i q3 = _mm_unpackhi_epi16(hi, hi);
+        expand(_mm_unpacklo_epi32(q0, q0), dst);
+        expand(_mm_unpackhi_epi32(q0, q0), dst + 16);
+        expand(_mm_unpacklo_epi32(q1, q1), dst + 32);
+        expand(_mm_unpackhi_epi32(q1, q1), dst + 48);
+        expand(_mm_unpacklo_epi32(q2, q2), dst + 64);
+        expand(_mm_unpackhi_epi32(q2, q2), dst + 80);
+        expand(_mm_unpacklo_epi32(q3, q3), dst + 96);
+        expand(_mm_unpackhi_epi32(q3, q3), dst + 112);
+    }
+    encode_scalar(ch + i, n - i, out + i * 8);
+}
+
+__attribute__((target("avx2")))
+static void encode_avx2(const uint8_t* ch, size_t n, char* out) {
+    const __m256i bits = _mm256_setr_epi8(ENCODE_BITS_16, ENCODE_BITS_16);
+    const __m256i low  = _mm256_set1_epi8(static_cast<char>(WS2812B_LOW));
+    const __m256i diff = _mm256_set1_epi8(static_cast<char>(WS2812B_HIGH ^ WS2812B_LOW));
+    // shuffle works per 128-bit lane: lane 0 spreads bytes 0,1 and lane 1 bytes 2,3
+    const __m256i spread = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+                                            2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        int32_t word;
+        std::memcpy(&word, ch + i, 4);
+        __m256i v   = _mm256_shuffle_epi8(_mm256_set1_epi32(word), spread);
+        __m256i set = _mm256_cmpeq_epi8(_mm256_and_si256(v, bits), bits);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i * 8),
+                            _mm256_xor_si256(low, _mm256_and_si256(set, diff)));
+    }
+    encode_scalar(ch + i, n - i, out + i * 8);
+}
+
+#endif // LED_ENCODE_X86
+
+#if LED_ENCODE_NEON
+
+static void encode_neon(const uint8_t* ch, size_t n, char* out) {
+    static const uint8_t bit_pattern[16] = { 0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+                                             0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01 };
+    const uint8x16_t bits = vld1q_u8(bit_pattern);
+    const uint8x16_t high = vdupq_n_u8(WS2812B_HIGH);
+    const uint8x16_t low  = vdupq_n_u8(WS2812B_LOW);
+    // table index for output vector k: channel bytes 2k and 2k+1, 8x each
+    uint8x16_t idx = vcombine_u8(vdup_n_u8(0), vdup_n_u8(1));
+    const uint8x16_t step = vdupq_n_u8(2);
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint8x16_t x  = vld1q_u8(ch + i);
+        uint8_t* dst  = reinterpret_cast<uint8_t*>(out + i * 8);
+        uint8x16_t ix = idx;
+        for (int k = 0; k < 8; k++) {
+            uint8x16_t v = vqtbl1q_u8(x, ix);
+            vst1q_u8(dst + k * 16, vbslq_u8(vtstq_u8(v, bits), high, low));
+            ix = vaddq_u8(ix, step);
+        }
+    }
+    encode_scalar(ch + i, n - i, out + i * 8);
+}
+
+#endif // LED_ENCODE_NEON
+
+encode_kernel_fn encode_kernel_by_name(const char* name) {
+    if (!name) return nullptr;
+    if (!std::strcmp(name, "scalar")) return encode_scalar;
+#if LED_ENCODE_X86
+    __builtin_cpu_init();
+    if (!std::strcmp(name, "sse2") && __builtin_cpu_supports("sse2")) return encode_sse2;
+    if (!std::strcmp(name, "avx2") && __builtin_cpu_supports("avx2")) return encode_avx2;
+#endif
+#if LED_ENCODE_NEON
+    if (!std::strcmp(name, "neon") && (getauxval(AT_HWCAP) & HWCAP_ASIMD)) return encode_neon;
+#endif
+    return nullptr;
+}
+
+// Startup guard: every channel byte expands independently, so checking each
+// value in each vector lane against the LUT catches a kernel that's wrong on
+// this cpu. `make test` checks all of them over every color.
+static bool kernel_matches_scalar(encode_kernel_fn kernel) {
+    const size_t n = 256 + 7; // odd length so the scalar tail runs too
+    uint8_t ch[n];
+    char got[n * 8], want[n * 8];
+    for (size_t lane = 0; lane < 32; lane++) {
+        for (size_t i = 0; i < n; i++) ch[i] = static_cast<uint8_t>(i + lane);
+        kernel(ch, n, got);
+        encode_scalar(ch, n, want);
+        if (std::memcmp(got, want, sizeof(got)) != 0) return false;
+    }
+    return true;
+}
+
+struct encode_selection_t {
+    encode_kernel_fn fn;
+    const char* name;
+};
+
+static encode_selection_t select_kernel() {
+    static const char* const preferred[] = { "neon", "avx2", "sse2" };
+    const char* forced = std::getenv("LED_ENCODE_KERNEL");
+    if (forced) {
+        encode_kernel_fn fn = encode_kernel_by_name(forced);
+        if (fn && kernel_matches_scalar(fn)) return { fn, forced };
+        printf("[Encode] kernel '%s' unavailable, picking automatically\n", forced);
+    }
+    for (const char* name : preferred) {
+        encode_kernel_fn fn = encode_kernel_by_name(name);
+        if (!fn) continue;
+        if (kernel_matches_scalar(fn)) return { fn, name };
+        printf("[Encode] kernel '%s' disagrees with the LUT, skipping it\n", name);
+    }
+    return { encode_scalar, "scalar" };
+}
+
+static const encode_selection_t& selected_kernel() {
+    static const encode_selection_t selection = select_kernel();
+    return selection;
+}
+
+const char* encode_frame_kernel() {
+    return selected_kernel().name;
+}
+
+void encode_frame(const LEDArray& leds, char* out) {
+    // swizzle to wire order first, the kernels only ever see a flat byte run
+    alignas(32) uint8_t grb[LED_COUNT * 3];
+    for (int j = 0; j < LED_COUNT; j++) {
+        grb[j * 3]     = leds[j].g;
+        grb[j * 3 + 1] = leds[j].r;
+        grb[j * 3 + 2] = leds[j].b;
+    }
+    selected_kernel().fn(grb, sizeof(grb), out);
+}
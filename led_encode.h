@@ -0,0 +1,28 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+#include "led_color.h"
+
+/*
+whole-frame GRB -> WS2812B symbol expansion.
+picks the widest kernel the cpu supports the first time it's used
+(NEON on the orin, AVX2/SSE2 on x86 dev boxes, the LUT otherwise).
+every kernel is checked against the scalar LUT on selection and we
+fall back to scalar if it ever disagrees.
+set LED_ENCODE_KERNEL=scalar|sse2|avx2|neon to force one.
+*/
+
+#define LED_FRAME_BYTES (LED_COUNT * 24)
+
+// expands `n` channel bytes (already in wire order) into n * 8 symbol bytes
+using encode_kernel_fn = void (*)(const uint8_t* channels, size_t n, char* out);
+
+// Encodes the whole frame into out (LED_FRAME_BYTES, every byte written).
+void encode_frame(const LEDArray& leds, char* out);
+
+// Name of the kernel encode_frame uses ("scalar", "sse2", "avx2", "neon").
+const char* encode_frame_kernel();
+
+// Direct access to a kernel by name, nullptr if it isn't built in or the cpu lacks it.
+encode_kernel_fn encode_kernel_by_name(const char* name);
@@ -0,0 +1,132 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+#include "led_color.h"
+#include "led_geometry.h"
+
+/*
+gaussian falloff shared by the orb style animations.
+exp(-x) is a range-reduced polynomial (relative error < 3e-5), anything
+past FALLOFF_CUTOFF is forced to 0: exp(-8) * 255 < 0.1 so it can never
+show up on an 8 bit channel. weights are computed 4 leds at a time with
+gcc vector extensions, which come out as SSE2 on x86 and NEON on the orin.
+whole rings outside the cutoff radius are skipped.
+*/
+
+#define FALLOFF_CUTOFF 8.0f
+
+namespace falloff_detail {
+    typedef float   v4f __attribute__((vector_size(16)));
+    typedef int32_t v4i __attribute__((vector_size(16)));
+
+    // exp(-x) for x >= 0. 2^t with t = -x*log2(e), split into an integer
+    // part that goes straight into the exponent bits and a fraction in
+    // (-1, 0] that gets a degree 6 taylor poly. truncation instead of floor
+    // keeps it SSE2 only.
+    inline v4f exp_neg(v4f x) {
+        x = x < FALLOFF_CUTOFF ? x : FALLOFF_CUTOFF;
+        v4f t = x * -1.44269504f;
+        v4i n = __builtin_convertvector(t, v4i);
+        v4f f = t - __builtin_convertvector(n, v4f);
+        v4f p = f * 1.5403530e-4f;
+        p = (p + 1.3333558e-3f) * f;
+        p = (p + 9.6181291e-3f) * f;
+        p = (p + 5.5504109e-2f) * f;
+        p = (p + 2.4022651e-1f) * f;
+        p = (p + 6.9314718e-1f) * f;
+        p = p + 1.0f;
+        v4i bits = (n + 127) << 23;
+        v4f scale;
+        std::memcpy(&scale, &bits, sizeof(scale));
+        return p * scale;
+    }
+}
+
+// Scalar version of the same approximation, x >= 0.
+inline float fast_exp_neg(float x) {
+    falloff_detail::v4f v = {x, x, x, x};
+    return falloff_detail::exp_neg(v)[0];
+}
+
+// Per-led weights in logical order. every lane is valid, [begin, end) just
+// brackets the rings that can be non zero so callers can skip the rest.
+struct led_weights_t {
+    alignas(16) float w[LED_LANES];
+    int begin = 0;
+    int end = 0;
+};
+
+// Gaussian weight of every led around an orb at (theta, r), sigma in ring
+// units. distance is the arc length at the mean radius plus the radial
+// offset, same metric the animators always used.
+inline void gaussian_falloff(float theta, float r, float sigma, led_weights_t& out) {
+    using namespace falloff_detail;
+    const float two_pi = 2.0f * M_PI_F;
+    theta = std::fmod(theta, two_pi);
+    if (theta < 0.0f) theta += two_pi;
+
+    // rings farther than the cutoff radius can't get any weight
+    const float reach = sigma * std::sqrt(2.0f * FALLOFF_CUTOFF);
+    int first = 0, last = -1;
+    for (int ring = 0; ring < 5; ++ring) {
+        if (std::fabs(static_cast<float>(ring) - r) > reach) continue;
+        if (last < 0) first = ring;
+        last = ring;
+    }
+    std::memset(out.w, 0, sizeof(out.w));
+    if (last < 0) {
+        out.begin = out.end = 0;
+        return;
+    }
+    out.begin = ring_layout[first].offset & ~3;
+    out.end = ring_layout[last].offset + ring_layout[last].size;
+    const int lane_end = (out.end + 3) & ~3;
+
+    const float inv = 1.0f / (2.0f * sigma * sigma);
+    for (int i = out.begin; i < lane_end; i += 4) {
+        v4f lt, lr;
+        std::memcpy(&lt, &led_geometry_soa.theta[i], sizeof(lt));
+        std::memcpy(&lr, &led_geometry_soa.r[i], sizeof(lr));
+        v4f dt = lt - theta;
+        dt = dt < 0.0f ? -dt : dt;
+        dt = dt > M_PI_F ? two_pi - dt : dt;
+        v4f rbar = (lr + r) * 0.5f;
+        v4f dr = lr - r;
+        v4f arc = dt * rbar;
+        v4f x = (arc * arc + dr * dr) * inv;
+        v4f w = exp_neg(x);
+        w = x < FALLOFF_CUTOFF ? w : 0.0f;
+        std::memcpy(&out.w[i], &w, sizeof(w));
+    }
+}
+
+// Same weights as Q8.8 (see led_color.h), multiplied by `scale` on the way.
+// this is the only float -> int step an orb takes per led, the colour math
+// after it is integer.
+struct led_weights_q8_t {
+    alignas(16) q8_t w[LED_LANES];
+    int begin = 0;
+    int end = 0;
+};
+
+inline void gaussian_falloff_q8(float theta, float r, float sigma, float scale, led_weights_q8_t& out) {
+    using namespace falloff_detail;
+    typedef uint16_t v4u16 __attribute__((vector_size(8)));
+    led_weights_t f;
+    gaussian_falloff(theta, r, sigma, f);
+    std::memset(out.w, 0, sizeof(out.w));
+    out.begin = f.begin;
+    out.end = f.end;
+    const int lane_end = (f.end + 3) & ~3;
+    const float k = scale * 256.0f;
+    for (int i = f.begin; i < lane_end; i += 4) {
+        v4f w;
+        std::memcpy(&w, &f.w[i], sizeof(w));
+        w = w * k + 0.5f;
+        w = w < 65535.0f ? w : 65535.0f;
+        v4u16 q = __builtin_convertvector(__builtin_convertvector(w, v4i), v4u16);
+        std::memcpy(&out.w[i], &q, sizeof(q));
+    }
+}
@@ -0,0 +1,158 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+#include "led_color.h"
+#include "led_render.h"
+#include "led_matrix.h"
+
+/*
+bake-and-loop cache for periodic animations.
+an animation with a Period() gets one cycle pre-rendered into a table of
+LED_BAKE_FRAMES frames, keyed by its ParamHash(). playback just advances a
+phase by dt / period and blends the two nearest baked frames, so a glow
+that used to cost exp()/HSV math every frame costs one lerp of 183 bytes.
+the speed isn't part of the table (the phase rate is), so an orb that
+speeds up with the typing keeps its table. tables are kept LRU, a few
+tens of KB each. everything here runs on the render thread only, inside
+Render(), so no clock reads or printing: a bake shows up in the render
+stage stats, counts come from Bakes() / Hits(), `make bench` times one.
+*/
+
+#define LED_BAKE_FRAMES 128          // per cycle, ~2.8 deg per frame for an orb
+#define LED_BAKE_CACHE_ENTRIES 8
+
+struct baked_frames_t {
+    uint64_t hash = 0;
+    std::vector<LEDArray> frames;
+};
+
+class LEDFrameCache {
+public:
+    explicit LEDFrameCache(size_t capacity = LED_BAKE_CACHE_ENTRIES) : capacity(capacity) {}
+
+    // Table for `animation`'s current params. On a miss it's baked from the
+    // live object over the cycle starting at `t`, frame 0 is its state at `t`.
+    std::shared_ptr<const baked_frames_t> Get(Animatable& animation, render_time_t t) {
+        const uint64_t hash = animation.ParamHash();
+        for (auto& e : entries) {
+            if (e.table->hash == hash) {
+                e.last_used = ++use_clock;
+                ++hits;
+                return e.table;
+            }
+        }
+        auto table = bake(animation, t, hash);
+        if (entries.size() >= capacity) {
+            auto lru = std::min_element(entries.begin(), entries.end(),
+                                        [](const entry_t& a, const entry_t& b) { return a.last_used < b.last_used; });
+            *lru = entry_t{table, ++use_clock};
+            ++evictions;
+        } else {
+            entries.push_back(entry_t{table, ++use_clock});
+        }
+        return table;
+    }
+
+    // Playback sticks to the nearest baked frame instead of blending two, so
+    // the frames going out repeat exactly (led_tx_cache.h keys on that). Only
+    // for tables with at least one baked frame per output frame at
+    // `output_fps`, slower cycles keep blending or they'd visibly step.
+    // 0 = always blend (the default).
+    void SetExactFrames(float output_fps) { exact_fps = output_fps; }
+    bool ExactFrames(float period) const {
+        return exact_fps > 0.0f && LED_BAKE_FRAMES >= exact_fps * std::fabs(period);
+    }
+
+    void Clear() { entries.clear(); }
+    size_t Size() const { return entries.size(); }
+    uint64_t Bakes() const { return bakes; }
+    uint64_t Hits() const { return hits; }
+    uint64_t Evictions() const { return evictions; }
+
+private:
+    struct entry_t {
+        std::shared_ptr<const baked_frames_t> table;
+        uint64_t last_used = 0;
+    };
+
+    std::shared_ptr<const baked_frames_t> bake(Animatable& animation, render_time_t t, uint64_t hash) {
+        auto table = std::make_shared<baked_frames_t>();
+        table->hash = hash;
+        table->frames.resize(LED_BAKE_FRAMES);
+        // one cycle from t on. frames are stored in the direction of a positive
+        // period, frame k is k/N of a turn ahead, so a table baked while the orb
+        // ran backwards still plays the right way once it turns around
+        const float period = animation.Period();
+        const auto step = std::chrono::duration_cast<render_clock::duration>(
+            std::chrono::duration<float>(std::fabs(period) / LED_BAKE_FRAMES));
+        for (int k = 0; k < LED_BAKE_FRAMES; ++k) {
+            int slot = period > 0.0f ? k : (LED_BAKE_FRAMES - k) % LED_BAKE_FRAMES;
+            animation.Render(t + step * k, table->frames[slot]);
+        }
+        ++bakes;
+        return table;
+    }
+
+    size_t capacity;
+    float exact_fps = 0.0f;
+    std::vector<entry_t> entries;
+    uint64_t use_clock = 0;
+    uint64_t bakes = 0;
+    uint64_t hits = 0;
+    uint64_t evictions = 0;
+};
+
+// Plays a periodic animation out of the cache, renders it live whenever it
+// isn't periodic (e.g. an orb that stopped).
+class CachedAnimation : public Animatable {
+public:
+    CachedAnimation(std::shared_ptr<Animatable> animation, LEDFrameCache& cache)
+        : animation(std::move(animation)), cache(cache) {}
+
+    void Render(render_time_t t, led_span_t out) override {
+        const float period = animation->Period();
+        float dt = advance(t);
+        if (period == 0.0f) {
+            table.reset();
+            animation->Render(t, out);
+            return;
+        }
+        if (!table || table->hash != animation->ParamHash()) {
+            // frame 0 of a new table is the animation at t already
+            table = cache.Get(*animation, t);
+            phase = 0.0f;
+        } else {
+            // signed: a negative period walks the table backwards
+            phase += dt / period;
+            phase -= std::floor(phase);
+        }
+
+        const float pos = phase * LED_BAKE_FRAMES;
+        if (cache.ExactFrames(period)) {
+            out.copy_from(table->frames[static_cast<int>(pos + 0.5f) % LED_BAKE_FRAMES]);
+            return;
+        }
+        // blend the two baked frames around the phase
+        const int a = static_cast<int>(pos) % LED_BAKE_FRAMES;
+        const int b = (a + 1) % LED_BAKE_FRAMES;
+        const uint32_t w = std::min<q8_t>(q8(pos - std::floor(pos)), Q8_ONE);
+        const uint8_t* pa = &table->frames[a][0].r;
+        const uint8_t* pb = &table->frames[b][0].r;
+        uint8_t* po = &out[0].r;
+        for (int i = 0; i < LED_COUNT * 3; ++i)
+            po[i] = lerp_q8(pa[i], pb[i], w);
+    }
+
+    float Period() const override { return animation->Period(); }
+    uint64_t ParamHash() const override { return animation->ParamHash(); }
+
+private:
+    std::shared_ptr<Animatable> animation;
+    LEDFrameCache& cache;
+    std::shared_ptr<const baked_frames_t> table;
+    float phase = 0.0f;   // 0..1 through the cycle
+};
@@ -0,0 +1,113 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+#include "led_color.h"
+
+/*
+board geometry, all of it computed at compile time.
+this is the one place to touch for a different board revision: change
+ring_sizes and the ring layout + per-led table follow.
+rings are numbered from the centre out, the strip is wired from the outer
+ring in. "logical" led order is ring by ring from the centre, "strip" order
+is what goes over SPI.
+*/
+
+//1, 8, 12, 16, 24
+static constexpr const int ring_sizes[5] = {1, 8, 12, 16, 24};
+static constexpr const float ring_incs[5] = {0.f, 45.f, 30.f, 22.5f, 15.f};
+
+// ring r occupies strip LEDs [phys_start, phys_start + size) with led 0 of the ring first.
+struct ring_layout_t {
+    int size;
+    int offset;       // first led of the ring in logical order
+    int phys_start;   // first led of the ring on the strip
+};
+
+static constexpr std::array<ring_layout_t, 5> ring_layout = [](){
+    std::array<ring_layout_t, 5> layout{};
+    int offset = 0;
+    for(int ring = 0; ring < 5; ++ring){
+        layout[ring] = { ring_sizes[ring], offset, LED_COUNT - (offset + ring_sizes[ring]) };
+        offset += ring_sizes[ring];
+    }
+    return layout;
+}();
+static_assert(ring_layout[4].offset + ring_layout[4].size == LED_COUNT, "ring_sizes must cover every led");
+static_assert(ring_layout[4].phys_start == 0, "outer ring starts the strip");
+
+struct led_geometry_t {
+    int ring;
+    int index;        // position within the ring
+    int strip;        // physical index on the strip
+    float theta;      // radians, [0, 2pi)
+    float r;          // radius in ring units
+    float cos_t, sin_t;
+    float x, y;       // r * cos, r * sin
+};
+
+namespace geometry_detail {
+    constexpr double PI = 3.14159265358979323846;
+    // taylor series, fine for the handful of angles on the board
+    constexpr double sin_series(double x) {
+        while (x > PI) x -= 2.0 * PI;
+        while (x < -PI) x += 2.0 * PI;
+        double term = x, sum = x;
+        for (int n = 1; n < 12; n++) {
+            term *= -x * x / ((2.0 * n) * (2.0 * n + 1.0));
+            sum += term;
+        }
+        return sum;
+    }
+    constexpr double cos_series(double x) {
+        return sin_series(x + PI / 2.0);
+    }
+}
+
+// One entry per LED in logical order.
+static constexpr std::array<led_geometry_t, LED_COUNT> led_geometry = [](){
+    std::array<led_geometry_t, LED_COUNT> geo{};
+    int idx = 0;
+    for(int ring = 0; ring < 5; ++ring){
+        for(int i = 0; i < ring_sizes[ring]; ++i){
+            double theta = (ring == 0) ? 0.0 : (2.0 * geometry_detail::PI / ring_sizes[ring]) * i;
+            double c = geometry_detail::cos_series(theta);
+            double s = geometry_detail::sin_series(theta);
+            geo[idx] = { ring, i, ring_layout[ring].phys_start + i,
+                         static_cast<float>(theta), static_cast<float>(ring),
+                         static_cast<float>(c), static_cast<float>(s),
+                         static_cast<float>(ring * c), static_cast<float>(ring * s) };
+            ++idx;
+        }
+    }
+    return geo;
+}();
+
+// Same data split per field so per-led loops vectorize. padded to a multiple
+// of 4 lanes, the padding sits far off the board so any falloff there is 0.
+#define LED_LANES ((LED_COUNT + 3) & ~3)
+
+struct led_geometry_soa_t {
+    alignas(16) float theta[LED_LANES];
+    alignas(16) float r[LED_LANES];
+    alignas(16) float x[LED_LANES];
+    alignas(16) float y[LED_LANES];
+    alignas(16) int strip[LED_LANES];
+};
+
+static constexpr led_geometry_soa_t led_geometry_soa = [](){
+    led_geometry_soa_t soa{};
+    for(int i = 0; i < LED_LANES; ++i){
+        if(i >= LED_COUNT){
+            soa.r[i] = soa.x[i] = soa.y[i] = 1000.f;
+            soa.strip[i] = -1;
+            continue;
+        }
+        soa.theta[i] = led_geometry[i].theta;
+        soa.r[i] = led_geometry[i].r;
+        soa.x[i] = led_geometry[i].x;
+        soa.y[i] = led_geometry[i].y;
+        soa.strip[i] = led_geometry[i].strip;
+    }
+    return soa;
+}();
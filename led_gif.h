@@ -0,0 +1,67 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/*
+gif image data for led_render: variable width LZW over 8 bit palette
+indices, already split into gif sub-blocks. header only so led_test can
+decode it back.
+*/
+
+// Appends the LZW minimum code size, the data sub-blocks and the block terminator.
+inline void gif_lzw(const std::vector<uint8_t>& indices, std::vector<uint8_t>& out) {
+    const int min_code_size = 8;
+    const uint32_t clear_code = 1u << min_code_size;
+    std::vector<uint8_t> bytes;
+    uint32_t bit_buf = 0;
+    int bit_count = 0;
+    int code_size = min_code_size + 1;
+    auto emit = [&](uint32_t code, int size) {
+        bit_buf |= code << bit_count;
+        bit_count += size;
+        while (bit_count >= 8) {
+            bytes.push_back(static_cast<uint8_t>(bit_buf));
+            bit_buf >>= 8;
+            bit_count -= 8;
+        }
+    };
+
+    std::unordered_map<uint32_t, uint32_t> dict;
+    uint32_t max_code = clear_code + 1;
+    emit(clear_code, code_size);
+    uint32_t cur = indices.empty() ? 0 : indices[0];
+    for (size_t i = 1; i < indices.size(); ++i) {
+        uint32_t key = (cur << 8) | indices[i];
+        auto it = dict.find(key);
+        if (it != dict.end()) {
+            cur = it->second;
+            continue;
+        }
+        emit(cur, code_size);
+        dict.emplace(key, ++max_code);
+        if (max_code >= (1u << code_size)) ++code_size;
+        if (max_code == 4095) {
+            emit(clear_code, code_size);
+            dict.clear();
+            code_size = min_code_size + 1;
+            max_code = clear_code + 1;
+        }
+        cur = indices[i];
+    }
+    emit(cur, code_size);
+    // the decoder adds one more entry when it reads that last code, and
+    // widens if that entry fills the table, so EOI goes out at the new width
+    if (max_code + 1 >= (1u << code_size) && code_size < 12) ++code_size;
+    emit(clear_code + 1, code_size);
+    if (bit_count > 0) bytes.push_back(static_cast<uint8_t>(bit_buf));
+
+    out.push_back(min_code_size);
+    for (size_t pos = 0; pos < bytes.size(); pos += 255) {
+        size_t n = std::min<size_t>(255, bytes.size() - pos);
+        out.push_back(static_cast<uint8_t>(n));
+        out.insert(out.end(), bytes.begin() + pos, bytes.begin() + pos + n);
+    }
+    out.push_back(0);
+}
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+#include "frame_clock.h"
+
+/*
+input rate -> orb speed for the typing state.
+keystrokes (or classification requests) come in from any thread at a few
+hundred per second, Push() just drops their timestamp into a fixed size
+lock-free queue, no allocation, no lock. the render thread drains it once
+per frame into an exponentially weighted rate (events/s, decays on its own
+when the input stops), maps that to a target speed and runs it through a
+critically damped spring so the orb never jerks when the rate jumps.
+*/
+
+#define INPUT_RATE_QUEUE_SIZE 256   // power of 2, ~4 frames worth of events at 60fps even at 4k keys/s
+
+namespace tfw {
+
+// Bounded multi producer / single consumer queue of timestamps.
+class InputEventQueue {
+public:
+    InputEventQueue() {
+        for (size_t i = 0; i < cells.size(); ++i) cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    // Any thread. False when the queue is full, the event is dropped.
+    bool Push(int64_t ts_ns) {
+        uint64_t pos = head.load(std::memory_order_relaxed);
+        cell_t* cell;
+        while (true) {
+            cell = &cells[pos & MASK];
+            uint64_t seq = cell->seq.load(std::memory_order_acquire);
+            int64_t diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos);
+            if (diff == 0) {
+                if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            } else {
+                pos = head.load(std::memory_order_relaxed);
+            }
+        }
+        cell->ts_ns = ts_ns;
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer thread only.
+    bool Pop(int64_t& ts_ns) {
+        cell_t& cell = cells[tail & MASK];
+        if (cell.seq.load(std::memory_order_acquire) != tail + 1) return false;
+        ts_ns = cell.ts_ns;
+        cell.seq.store(tail + MASK + 1, std::memory_order_release);
+        ++tail;
+        return true;
+    }
+
+    uint64_t Dropped() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr uint64_t MASK = INPUT_RATE_QUEUE_SIZE - 1;
+    static_assert((INPUT_RATE_QUEUE_SIZE & MASK) == 0, "queue size has to be a power of 2");
+
+    struct cell_t {
+        std::atomic<uint64_t> seq;
+        int64_t ts_ns;
+    };
+
+    std::array<cell_t, INPUT_RATE_QUEUE_SIZE> cells;
+    alignas(64) std::atomic<uint64_t> head{0};   // producers
+    alignas(64) uint64_t tail = 0;               // consumer
+    std::atomic<uint64_t> dropped{0};
+};
+
+// Events per second, exponentially weighted with time constant `tau`. Every
+// event adds 1/tau, the sum decays with exp(-dt/tau), so a steady input at
+// n/s settles at n and a burst fades out instead of stopping dead.
+class InputRateEstimator {
+public:
+    explicit InputRateEstimator(float tau_s = 1.0f) : tau_ns(tau_s * 1e9f) {}
+
+    // Any thread, allocation free.
+    void Push(int64_t ts_ns = FrameClock::now_ns()) { queue.Push(ts_ns); }
+
+    // Consumer thread: drains the queue, returns the rate at `now_ns`.
+    float Rate(int64_t now_ns) {
+        int64_t ts;
+        while (queue.Pop(ts)) {
+            // producers race each other, a slightly older stamp just counts as "now"
+            if (ts > last_ns) {
+                rate *= decay(ts - last_ns);
+                last_ns = ts;
+            }
+            rate += 1e9f / tau_ns;
+        }
+        if (now_ns <= last_ns) return rate;
+        return rate * decay(now_ns - last_ns);
+    }
+    void Reset() {
+        int64_t ts;
+        while (queue.Pop(ts)) {}
+        rate = 0.0f;
+        last_ns = 0;
+    }
+
+    uint64_t Dropped() const { return queue.Dropped(); }
+
+private:
+    float decay(int64_t dt_ns) const { return std::exp(-static_cast<float>(dt_ns) / tau_ns); }
+
+    InputEventQueue queue;
+    float tau_ns;
+    // consumer thread only
+    float rate = 0.0f;
+    int64_t last_ns = 0;
+};
+
+// Critically damped spring towards a moving target: no overshoot, no jump
+// in velocity. smooth_time is roughly how long it takes to catch up.
+class CriticallyDampedValue {
+public:
+    explicit CriticallyDampedValue(float smooth_time_s = 0.35f, float value = 0.0f)
+        : omega(2.0f / smooth_time_s), value(value) {}
+
+    void Reset(float v) {
+        value = v;
+        velocity = 0.0f;
+    }
+    // Closed form step, stable for any dt (a dropped frame just catches up).
+    float Step(float target, float dt_s) {
+        float x = omega * dt_s;
+        float e = 1.0f / (1.0f + x + 0.48f * x * x + 0.235f * x * x * x);
+        float change = value - target;
+        float temp = (velocity + omega * change) * dt_s;
+        velocity = (velocity - omega * temp) * e;
+        value = target + (change + temp) * e;
+        return value;
+    }
+    float Value() const { return value; }
+
+private:
+    float omega;
+    float value;
+    float velocity = 0.0f;
+};
+
+// Keystroke rate -> orb speed in deg/s.
+class TypingSpeed {
+public:
+    TypingSpeed(float min_speed = 90.0f, float max_speed = 360.0f, float deg_per_key = 30.0f)
+        : min_speed(min_speed), max_speed(max_speed), deg_per_key(deg_per_key), smooth(0.35f, min_speed) {}
+
+    // Any thread.
+    void Keystroke(int64_t ts_ns = FrameClock::now_ns()) { rate.Push(ts_ns); }
+
+    // Render thread, once per frame.
+    float Speed(int64_t now_ns) {
+        float target = std::min(max_speed, min_speed + deg_per_key * rate.Rate(now_ns));
+        float dt = last_ns ? static_cast<float>(now_ns - last_ns) * 1e-9f : 0.0f;
+        last_ns = now_ns;
+        return smooth.Step(target, std::max(dt, 0.0f));
+    }
+    // Render thread. Picks up smoothing from `from` deg/s, e.g. the speed the
+    // orb already has; NAN starts right at the current rate's speed.
+    void Restart(int64_t now_ns, float from = NAN) {
+        smooth.Reset(std::isnan(from) ? std::min(max_speed, min_speed + deg_per_key * rate.Rate(now_ns)) : from);
+        last_ns = now_ns;
+    }
+
+    uint64_t Dropped() const { return rate.Dropped(); }
+
+private:
+    float min_speed;
+    float max_speed;
+    float deg_per_key;
+    InputRateEstimator rate;
+    CriticallyDampedValue smooth;
+    int64_t last_ns = 0;
+};
+
+}
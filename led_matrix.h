@@ -11,14 +11,9 @@
 #include <cstdlib>
 
 #include "led_color.h"
-
-
-
-using LEDArray = std::array<led_color_t, LED_COUNT>;
-
-//1, 8, 12, 16, 24
-static constexpr const int ring_sizes[5] = {1, 8, 12, 16, 24};
-static constexpr const float ring_incs[5] = {0.f, 45.f, 30.f, 22.5f, 15.f};
+#include "led_geometry.h"
+#include "led_falloff.h"
+#include "led_render.h"
 
 
 inline float ringunit(int ring, float mul){
@@ -72,96 +67,26 @@ struct polar_t{
     }
 };
 
-class LEDRingBase{
-    public:
-        LEDRingBase(int index) : index(index) {
-        }
-    
-        virtual void Update(LEDArray& leds) = 0;
-    
-        virtual const int Count() const = 0;
-        const auto Index() const {
-            return index;
-        }
-        virtual void clear(led_color_t clr = {0,0,0}) = 0;
-        virtual void set_led(int idx, led_color_t color) = 0;
-    protected:
-        const int index;
-    };
-    
-    template <std::size_t N>
-    class LEDRing : public LEDRingBase {
-    public:
-        LEDRing(int index) : LEDRingBase(index), led_count(leds.size()) {
-            start_idx = 0;
-            for(int i = 0; i < index; ++i)
-                start_idx += ring_sizes[i];
-            end_idx = start_idx + N;
-            assert(end_idx <= LED_COUNT);
-    
-            //flip indices 
-            int temp = start_idx;
-            start_idx = LED_COUNT - end_idx;
-            end_idx = LED_COUNT - temp;
-            printf("Ring[%d] %d: %d - %d\n", index, led_count, start_idx, end_idx);
-            
-            for(auto& led : leds)
-                led = {125,125,125};// generate_random_color();
-        }
-    
-        const int Count() const override { return led_count; }
-    
-    
-        void Update(LEDArray& all) override {
-            for(int i = start_idx; i < end_idx; ++i){
-                if(index == 4) all[i] = leds[i - start_idx] * 0.37f;
-                else if(index == 3) all[i] = leds[i - start_idx] * 1.66f;
-                else all[i] = leds[i - start_idx];
-            }
-    
-        }
-    
-    
-        void set_led(int idx, led_color_t color) override {
-            if(idx < 0 || static_cast<std::size_t>(idx) >= N) throw std::out_of_range("LED index out of range");
-            if(color)
-                leds[idx] = leds[idx] + color;
-            else 
-                leds[idx] = color;
-        }
-    
-        void clear(led_color_t clr = {0,0,0}) override {
-            for(auto& led : leds)
-                led = clr;
-        }
-    protected:
-        const int led_count;
-        int start_idx;
-        int end_idx;
-        std::array<led_color_t, N> leds; 
-    };
-    
+// led_geometry as polar coords, logical order
+static constexpr std::array<polar_t, LED_COUNT> led_polar = [](){
+    std::array<polar_t, LED_COUNT> lut{};
+    for(int i = 0; i < LED_COUNT; ++i)
+        lut[i] = polar_t{led_geometry[i].theta, led_geometry[i].r};
+    return lut;
+}();
+
     class LEDMatrix {
     public:
         LEDMatrix() {
-            this->rings = {
-                std::make_unique<LEDRing<1>>(0),
-                std::make_unique<LEDRing<8>>(1),
-                std::make_unique<LEDRing<12>>(2),
-                std::make_unique<LEDRing<16>>(3),
-                std::make_unique<LEDRing<24>>(4),
-            };
             set_all({0,0,0});
         }
     
         void Clear(LEDArray& leds, led_color_t clr = {0,0,0}){
-            for(auto& ring : rings){
-                ring->clear(clr);
-            }
+            framebuffer.fill(clr);
             this->Update(leds);
         }
         //returns ring index, led index within ring 
-        std::pair<int, int> polar_to_ring(float angle_deg, int radius){
+        static std::pair<int, int> polar_to_ring(float angle_deg, int radius){
             if(std::abs(radius) > 4) return {0xffff, 0xffff};
             if(radius == 0) return {0, 0};
             if(angle_deg >= 360.f){
@@ -172,8 +97,7 @@ class LEDRingBase{
             }
     
             int ring = abs(radius); 
-            float angle = DEG2RAD(angle_deg);
-            float led_idx_f = (angle / (2.f * M_PI_F) ) * (ring_sizes[ring]);
+            float led_idx_f = (angle_deg / 360.f) * (ring_sizes[ring]);
            
             int led = static_cast<int>(std::round(led_idx_f));
             if(led != 0 && led == ring_sizes[ring]) led = 0;
@@ -181,7 +105,7 @@ class LEDRingBase{
           //  printf("angle: %f, radius: %d, ring: %d, led: %d\n", angle_deg, radius, ring, led); 
             return {ring, led};
         }
-        std::pair<int, int> polar_to_ring(polar_t coords){
+        static std::pair<int, int> polar_to_ring(polar_t coords){
             if(std::abs(coords.r) > 4.0f) return {0xffff, 0xffff};
             if(coords.r < 0.5f) return {0, 0};  // Consider values less than 0.5 as center
             coords.normalize();
@@ -200,22 +124,13 @@ class LEDRingBase{
         std::pair<int, int> grid_to_ring(int x, int y) {
             if(x == 0 && y == 0) return {0, 0};
             if(std::abs(x) > 4 || std::abs(y) > 4) return {0xffff, 0xffff};
-    
-            float theta = atan2(y, x);
-    
-            int radius = static_cast<int>(std::round(std::sqrt(x * x + y * y)));
-    
-          
-            return polar_to_ring(RAD2DEG(theta), radius);
+            return grid_lut[(y + 4) * 9 + (x + 4)];
         }
     
+        // writes the framebuffer out, ring gains and gamma are applied later
+        // by the manager's output stage (led_output.h)
         void Update(LEDArray& leds) {
-    
-            for(auto& ring : rings){
-                ring->Update(leds);
-            }
-    
-    
+            leds = framebuffer;
         }
     
     
@@ -224,7 +139,7 @@ class LEDRingBase{
             if(ring == 0xffff || led == 0xffff) {
                 throw std::out_of_range("Invalid coords: " + std::to_string(angle_deg) + ", " + std::to_string(radius));
             }
-            rings[ring]->set_led(led, color);
+            set_ring_led(ring, led, color);
         }
     
         void set_led(float angle_deg, float radius, led_color_t color){
@@ -240,9 +155,24 @@ class LEDRingBase{
                 printf("Invalid coords: %f, %f\n", RAD2DEG(coords.theta), coords.r);
                 return;
             }
-            rings[ring]->set_led(led, color);
+            set_ring_led(ring, led, color);
+        }
+
+        // adds onto whatever is there, black clears the led
+        void set_ring_led(int ring, int idx, led_color_t color){
+            if(ring < 0 || ring >= 5 || idx < 0 || idx >= ring_layout[ring].size) throw std::out_of_range("LED index out of range");
+            led_color_t& led = framebuffer[ring_layout[ring].phys_start + idx];
+            if(color)
+                led = led + color;
+            else
+                led = color;
         }
     
+        // raw framebuffer in strip order. for code that
+        // produces whole frames (e.g. the compositor) instead of single leds
+        LEDArray& Framebuffer() { return framebuffer; }
+        const LEDArray& Framebuffer() const { return framebuffer; }
+
         void set_all(led_color_t color){
             // Add debug print to verify this is actually called
             static int set_all_count = 0;
@@ -251,15 +181,28 @@ class LEDRingBase{
                       set_all_count, color.r, color.g, color.b);
             }
             
-            for(auto& ring : rings){
-                for(int i = 0; i < ring->Count(); ++i){
-                    ring->set_led(i, color);
-                }
+            for(auto& led : framebuffer){
+                led = color ? led + color : color;
             }
         }
     
     protected:
-        std::array<std::unique_ptr<LEDRingBase>, 5> rings;
+        // grid_to_ring for every point of the 9x9 grid, built once
+        static inline const std::array<std::pair<int, int>, 81> grid_lut = [](){
+            std::array<std::pair<int, int>, 81> lut{};
+            for(int y = -4; y <= 4; ++y){
+                for(int x = -4; x <= 4; ++x){
+                    float theta = atan2(y, x);
+                    int radius = static_cast<int>(std::round(std::sqrt(x * x + y * y)));
+                    lut[(y + 4) * 9 + (x + 4)] = (x == 0 && y == 0) ? std::pair<int, int>{0, 0}
+                                                                    : polar_to_ring(RAD2DEG(theta), radius);
+                }
+            }
+            return lut;
+        }();
+
+        // single buffer in strip order
+        LEDArray framebuffer{};
     };
     
     struct animLED{
@@ -269,12 +212,22 @@ class LEDRingBase{
     
     class Animatable{
     public:
-        Animatable() {
-            start = std::chrono::high_resolution_clock::now();
-        }
-        virtual void Update() = 0;
-        virtual void Draw(LEDMatrix* matrix) = 0;
         virtual ~Animatable() = default;
+
+        // Renders the frame for time `t` into `out`: strip order, linear
+        // colours, every one of the LED_COUNT leds written. no clock reads and
+        // no I/O in here, time only comes in through `t`, so whatever drives
+        // the animation (render thread, cache, offline render) gets the same
+        // frames for the same sequence of t.
+        virtual void Render(render_time_t t, led_span_t out) = 0;
+
+        // Seconds after which the frames repeat exactly, 0 = not periodic.
+        // periodic animations get baked into a frame table and looped
+        // (led_frame_cache.h). ParamHash() tells the tables apart, it has to
+        // cover everything that changes the look except the speed, a negative
+        // period plays the cycle backwards.
+        virtual float Period() const { return 0.0f; }
+        virtual uint64_t ParamHash() const { return 0; }
     
         void SetOrigin(float angle_deg, int radius){
            this->origin = polar_t::Degrees(angle_deg, static_cast<float>(radius));
@@ -289,15 +242,47 @@ class LEDRingBase{
             return origin;
         }
         
-        // Make start time accessible for fusion calculations
-        std::chrono::time_point<std::chrono::high_resolution_clock> start;
-        
+        // time of the first Render, for fusion calculations
+        render_time_t start{};
+
     protected:
+        // seconds since the previous call (0 on the first one, which also
+        // sets `start`), for animations that advance by elapsed time
+        float advance(render_time_t t) {
+            if (!started) {
+                started = true;
+                start = last_t = t;
+            }
+            float dt = std::max(0.0f, render_seconds(last_t, t));
+            last_t = t;
+            return dt;
+        }
+
         std::vector<animLED> leds;
         polar_t origin;
+        bool started = false;
+        render_time_t last_t{};
+    };
+
+    // Animations that place their leds by polar coords: they step in
+    // Update(t), set_led() into a matrix of their own in Draw() and Render()
+    // hands the matrix out.
+    class MatrixAnimatable : public Animatable{
+    public:
+        void Render(render_time_t t, led_span_t out) override {
+            Update(t);
+            matrix.Framebuffer().fill({0, 0, 0});
+            Draw(&matrix);
+            out.copy_from(matrix.Framebuffer());
+        }
+        virtual void Update(render_time_t t) = 0;
+        virtual void Draw(LEDMatrix* matrix) = 0;
+
+    protected:
+        LEDMatrix matrix;
     };
     
-    class Orb : public Animatable{
+    class Orb : public MatrixAnimatable{
         public:
         Orb(int size = 3,  led_color_t base_color = {245,245,245}, polar_t origin = {0.f, 3.0f}) {
             // Make sure the origin is normalized
@@ -350,15 +335,15 @@ class LEDRingBase{
                 }
                 mul *= mulmul;
             }
-            last_update = std::chrono::high_resolution_clock::now();
         }
     
-        void Update() override {
-            uint64_t us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - last_update).count();
-            if(us < 2000) return; //smoothing this would be nice
-            last_update = std::chrono::high_resolution_clock::now();
+        void Update(render_time_t t) override {
+            // rot_speed is deg/s and the ramp was tuned per 20 ms frame, both
+            // scale with elapsed time so the orb moves the same at any fps
+            const float dt = advance(t);
+            const float frames = std::min(dt / 0.020f, 5.0f);
     
-           uint64_t delta_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start).count();
+           uint64_t delta_ms = std::chrono::duration_cast<std::chrono::milliseconds>(t - start).count();
             
             
             float scale = exp((rot_speed * 0.0001f) / max_speed);
@@ -370,12 +355,12 @@ class LEDRingBase{
             const uint64_t hold_time = 2500;
             if(!speed_up && delta_ms > (hold_time + last_speedchange) && std::abs(rot_speed) > base_speed){
                   
-                rot_speed *= (imul);
+                rot_speed *= std::pow(imul, frames);
                 //printf("not speed up: %f \n", rot_speed);
             }
             else if(speed_up && delta_ms > (hold_time + last_speedchange) && std::abs(rot_speed) < max_speed){
               
-                rot_speed *= (mul);
+                rot_speed *= std::pow(mul, frames);
                 //printf("speed up %f \n", rot_speed);
             }
             if((rot_speed <= base_speed || std::abs(rot_speed) > max_speed) && delta_ms > (hold_time + last_speedchange)){
@@ -386,7 +371,7 @@ class LEDRingBase{
                // printf("speed change: %f, %d, %lu\n", rot_speed, speed_up, last_speedchange);
             }
     
-           this->origin.rotate_deg(rot_speed * m);
+           this->origin.rotate_deg(rot_speed * m * dt);
            
            // Update all LED colors if the main color has changed
            if (color != prev_color) {
@@ -438,11 +423,10 @@ class LEDRingBase{
         led_color_t color;
         led_color_t prev_color = {0,0,0};  // Track previous color to detect changes
         
-        float max_speed = 270.f;
-        float rot_speed = max_speed;
+        float max_speed = 270.f;          // deg/s
+        float rot_speed = max_speed;      // deg/s
         bool speed_up = false;
         uint64_t last_speedchange = 0;
-        std::chrono::time_point<std::chrono::high_resolution_clock> last_update;
         float m = 1.f;
     };
     
@@ -453,7 +437,7 @@ class LEDRingBase{
 
 
     // ─── Glow (smooth triangle-wave version) ───────────────────────
-class Glow : public Animatable {
+class Glow : public MatrixAnimatable {
 public:
     Glow(int size = 3,
          led_color_t base_color = {255,255,255},
@@ -476,27 +460,25 @@ public:
 
         /* --- NEW driver state ---------------------------------- */
         phase = 0.0f;                    // 0 … 2  (wraps)
-        // frame-rate independent speed: 0.015 ≈ 1.5 s full cycle
-        phase_inc = 0.015f;              // tweak to taste (≈1.5 s full cycle)
+        // advance per 20 ms of elapsed time: 0.015 ≈ 2.7 s full cycle
+        phase_inc = 0.015f;              // tweak to taste
         /* ------------------------------------------------------- */
-
-        last_update = std::chrono::high_resolution_clock::now();
     }
 
     /* -------- animation scaffold -------------------------------- */
-    void Update() override
+    void Update(render_time_t t) override
     {
         /* -------- 1 · timing guard first -------- */
-        uint64_t us = std::chrono::duration_cast<std::chrono::microseconds>(
-                          std::chrono::high_resolution_clock::now() - last_update).count();
-        if (us < 800) return;
-        last_update = std::chrono::high_resolution_clock::now();
+        // leds keep the last colours when called again within 0.8 ms
+        if (started && t - last_t < std::chrono::microseconds(800)) return;
+        // phase_inc was tuned per 20 ms frame, scale so the cycle is fps independent
+        float frames = std::min(advance(t) / 0.020f, 5.0f);
 
         /* -------- 2 · clear local cache ---------- */
         for (auto& led : leds) led.color = min_color;
 
         /* -------- 3 · cosine-driven radius ------- */
-        phase += phase_inc;
+        phase += phase_inc * frames;
         if (phase >= 2.0f) phase -= 2.0f;
 
         // smooth 0→max→0 using  (1-cos(π·p))/2
@@ -505,8 +487,8 @@ public:
                        static_cast<float>(max_size);
 
         /* -------- 4 · per-ring intensity --------- */
-        set_ring(0, min_color +
-                     ((base_color - min_color) * 0.25f));
+        const led_color_t span = base_color - min_color;
+        set_ring(0, min_color + scale_q8(span, q8(0.25f)));
 
         for (int ring = 1; ring < max_size; ++ring)
         {
@@ -518,8 +500,7 @@ public:
             // natural distance fade
             intensity *= (1.0f - ring * 0.1f);
 
-            led_color_t ring_color = min_color +
-                                      ((base_color - min_color) * intensity);
+            led_color_t ring_color = min_color + scale_q8(span, q8(intensity));
             set_ring(ring, ring_color);
         }
     }
@@ -530,6 +511,12 @@ public:
             matrix->set_led(origin + led.origin, led.color);
     }
 
+    // phase runs 0..2 at phase_inc per 20 ms
+    float Period() const override { return 2.0f / phase_inc * 0.020f; }
+    uint64_t ParamHash() const override {
+        return param_hasher("glow").add(base_color).add(min_color).add(max_size).add(phase_inc).value();
+    }
+
 private:
 
     led_color_t base_color, min_color;
@@ -537,9 +524,8 @@ private:
     float current_size = 0.0f;
 
     float phase       = 0.0f;    // 0-2 triangle position
-    float phase_inc   = 0.015f;  // tweak to taste (≈1.5 s full cycle)
-  
-    std::chrono::time_point<std::chrono::high_resolution_clock> last_update;
+    float phase_inc   = 0.015f;  // per 20 ms, tweak to taste
+
     /* cached LED geometry          */
     void set_ring(int ring, led_color_t color) {
         int idx = 1; for (int i = 0; i < ring; ++i) idx += ring_sizes[i];
@@ -548,7 +534,7 @@ private:
 };
 
 
-    class Loader : public Animatable {
+    class Loader : public MatrixAnimatable {
     public:
         Loader(led_color_t color = {20, 150, 40}, uint32_t duration_ms = 1500) 
         : color(color), 
@@ -557,22 +543,16 @@ private:
           progress(0.0f),
           gaussian_sigma(1.5f),  // Controls the spread of the gaussian effect
           trail_length(8.0f) {   // How many LEDs the trail extends
-            last_update = std::chrono::high_resolution_clock::now();
-            
-            // Pre-compute LED positions for smoother animation
-            BuildLEDLUT();
         }
 
         bool finished() const {
             return is_finished;
         }
 
-        void Update() override {
+        void Update(render_time_t t) override {
             if (is_finished) return;
 
-            auto now = std::chrono::high_resolution_clock::now();
-            float elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_update).count();
-            last_update = now;
+            float elapsed_ms = advance(t) * 1000.0f;
 
             // Update progress as a continuous float from 0 to LED_COUNT
             float progress_speed = static_cast<float>(LED_COUNT) / static_cast<float>(duration_ms);
@@ -586,35 +566,34 @@ private:
         void Draw(LEDMatrix* matrix) override {
             if (is_finished) return;
 
-            // Apply smooth Gaussian wave effect
-            for (int i = 0; i < LED_COUNT; ++i) {
+            // Apply smooth Gaussian wave effect, only leds within the trail
+            // can light up
+            const float inv = 1.0f / (2.0f * gaussian_sigma * gaussian_sigma);
+            int first = std::max(0, static_cast<int>(std::ceil(progress - trail_length)));
+            int last = std::min(LED_COUNT - 1, static_cast<int>(std::floor(progress + trail_length)));
+            for (int i = first; i <= last; ++i) {
                 // Calculate distance from current progress position
                 float distance = std::abs(static_cast<float>(i) - progress);
                 
-                // Apply Gaussian falloff for smooth trailing effect
-                float intensity = 0.0f;
-                if (distance <= trail_length) {
-                    // Gaussian function: exp(-x²/2σ²)
-                    float gaussian_factor = std::exp(-(distance * distance) / (2.0f * gaussian_sigma * gaussian_sigma));
-                    
-                    // Additional falloff based on distance for trailing effect
-                    float trail_factor = 1.0f - (distance / trail_length);
-                    trail_factor = std::max(0.0f, trail_factor);
-                    
-                    // Combine both effects
-                    intensity = gaussian_factor * trail_factor;
-                    
-                    // Add some extra brightness at the leading edge
-                    if (distance < 0.5f) {
-                        intensity = std::min(1.0f, intensity * 1.3f);
-                    }
+                // Gaussian function: exp(-x²/2σ²)
+                float gaussian_factor = fast_exp_neg(distance * distance * inv);
+
+                // Additional falloff based on distance for trailing effect
+                float trail_factor = 1.0f - (distance / trail_length);
+                trail_factor = std::max(0.0f, trail_factor);
+
+                // Combine both effects
+                float intensity = gaussian_factor * trail_factor;
+
+                // Add some extra brightness at the leading edge
+                if (distance < 0.5f) {
+                    intensity = std::min(1.0f, intensity * 1.3f);
                 }
                 
                 // Apply the intensity to the color
                 if (intensity > 0.01f) {  // Only draw if intensity is significant
-                    led_color_t smooth_color = color * intensity;
-                    polar_t led_pos = led_lut[i];
-                    matrix->set_led(led_pos, smooth_color);
+                    led_color_t smooth_color = scale_q8(color, q8(intensity));
+                    matrix->set_led(led_polar[i], smooth_color);
                 }
             }
         }
@@ -626,21 +605,6 @@ private:
         float progress;              // Current position in the animation (0 to LED_COUNT)
         float gaussian_sigma;        // Controls the spread of the gaussian effect
         float trail_length;          // Length of the trailing effect
-        std::chrono::time_point<std::chrono::high_resolution_clock> last_update;
-        
-        // Pre-computed lookup table for LED positions
-        std::array<polar_t, LED_COUNT> led_lut;
-        
-        void BuildLEDLUT() {
-            int idx = 0;
-            for (int ring = 0; ring < 5; ++ring) {
-                int count = ring_sizes[ring];
-                for (int i = 0; i < count; ++i) {
-                    float theta = (ring == 0) ? 0.0f : DEG2RAD((360.0f / count) * i);
-                    led_lut[idx++] = polar_t{theta, static_cast<float>(ring)};
-                }
-            }
-        }
     };
     
     //helper for ang diff
@@ -694,7 +658,6 @@ private:
                          const std::array<HSV,3>& to,
                          float duration = 1.8f)
         : hsv_from(from), hsv_to(to), phase(IN), t_phase(0.0f) {
-            last_update = std::chrono::high_resolution_clock::now();
             
             // Set unique rotation speeds for each orb for more dynamic movement
             orb_speeds = {320.0f, 340.0f, 300.0f};
@@ -714,8 +677,6 @@ private:
                 orbPtr->max_speed = orb_speeds[k] * 1.2f;
             }
             
-            // Set phase start times for timing progress
-            phase_start_time = std::chrono::high_resolution_clock::now();
             this->dt = 0.0f;
             
             // Record initial positions for animation
@@ -741,11 +702,15 @@ private:
     
         bool finished() const { return phase == DONE; }
         
-        void Update() override {
+        void Render(render_time_t t, led_span_t out) override {
+            Update(t);
+            DrawTransition(out);
+        }
+
+        // advances the phases to time t
+        void Update(render_time_t t) {
             // advance t_phase based on elapsed time
-            auto now = std::chrono::high_resolution_clock::now();
-            dt = std::chrono::duration<float>(now - last_update).count();
-            last_update = now;
+            dt = advance(t);
             t_phase += dt;
             
             // Update phase based on timing
@@ -790,14 +755,14 @@ private:
             }
             
             if (phase_changed) {
-                phase_start_time = std::chrono::high_resolution_clock::now();
+                phase_start_time = t;
             }
     
             // Total progress currently unused, keep placeholder for future visualisation features
             
             // Calculate overall transition progress (0.0 - 1.0)
             float totalDuration = T_in + T_fusion + T_flash + T_expansion + T_out;
-            float elapsedTime = std::chrono::duration<float>(now - start).count();
+            float elapsedTime = render_seconds(start, t);
             float overallProgress = std::min(1.0f, elapsedTime / totalDuration);
             
             // Get normalized time within the current phase (0-1)
@@ -951,14 +916,9 @@ private:
             }
         }
     
-        // Override the required Draw method from Animatable
-        void Draw(LEDMatrix* matrix) override {
-            // This is just a stub that redirects to our custom Draw method with LEDs
-            // This is needed because we inherit from Animatable which has a pure virtual Draw method
-        }
-        
-        // Our custom Draw method that takes additional parameters
-        void DrawTransition(LEDMatrix* matrix, std::array<led_color_t, LED_COUNT>& leds, const std::array<polar_t, LED_COUNT>& led_lut) {
+    private:
+        // renders the current phase straight into the strip-ordered frame
+        void DrawTransition(led_span_t leds) {
             // If in FLASH phase, create a bright flash effect
             if (phase == FLASH) {
                 // Flash phase: pulse white with subtle color undertones
@@ -969,25 +929,23 @@ private:
                     flashIntensity = 1.0f - ((t_phase - T_flash * 0.5f) / (T_flash * 0.5f));
                 }
                 
-                // Create a bright white/color blend with subtle color hints
-                for (int i = 0; i < LED_COUNT; ++i) {
-                    // Get a blend of all three orb colors for a richer flash effect
-                    led_color_t base_color1 = dynamic_cast<Orb*>(orbs[0].get())->color;
-                    led_color_t base_color2 = dynamic_cast<Orb*>(orbs[1].get())->color;
-                    led_color_t base_color3 = dynamic_cast<Orb*>(orbs[2].get())->color;
-                    
-                    // Average the colors and add white for flash
-                    uint8_t r = static_cast<uint8_t>((base_color1.r + base_color2.r + base_color3.r) / 3);
-                    uint8_t g = static_cast<uint8_t>((base_color1.g + base_color2.g + base_color3.g) / 3);
-                    uint8_t b = static_cast<uint8_t>((base_color1.b + base_color2.b + base_color3.b) / 3);
-                    
-                    // Blend with white for flash effect
-                    r = static_cast<uint8_t>(r * 0.3f + 255 * 0.7f * flashIntensity);
-                    g = static_cast<uint8_t>(g * 0.3f + 255 * 0.7f * flashIntensity);
-                    b = static_cast<uint8_t>(b * 0.3f + 255 * 0.7f * flashIntensity);
-                    
-                    leds[i] = {r, g, b};
-                }
+                // Create a bright white/color blend with subtle color hints,
+                // it's the same for every led so work it out once
+                led_color_t base_color1 = orbs[0]->color;
+                led_color_t base_color2 = orbs[1]->color;
+                led_color_t base_color3 = orbs[2]->color;
+
+                // Average the colors and add white for flash
+                uint8_t r = static_cast<uint8_t>((base_color1.r + base_color2.r + base_color3.r) / 3);
+                uint8_t g = static_cast<uint8_t>((base_color1.g + base_color2.g + base_color3.g) / 3);
+                uint8_t b = static_cast<uint8_t>((base_color1.b + base_color2.b + base_color3.b) / 3);
+
+                // Blend with white for flash effect
+                r = static_cast<uint8_t>(r * 0.3f + 255 * 0.7f * flashIntensity);
+                g = static_cast<uint8_t>(g * 0.3f + 255 * 0.7f * flashIntensity);
+                b = static_cast<uint8_t>(b * 0.3f + 255 * 0.7f * flashIntensity);
+
+                leds.fill({r, g, b});
                 
                 return;
             }
@@ -999,34 +957,28 @@ private:
             }
             
             // Apply Gaussian blending for each orb (similar to the active state)
+            led_weights_q8_t F;
             for (size_t o = 0; o < orbs.size(); ++o) {
-                auto orbPtr = dynamic_cast<Orb*>(orbs[o].get());
-                polar_t C = orbPtr->GetOrigin();
-                
-                // For each LED in the matrix
-                for (int i = 0; i < LED_COUNT; ++i) {
-                    polar_t P = led_lut[i];
-                    
-                    // Calculate Gaussian influence based on distance
-                    float dθ = angularDifference(P.theta, C.theta);
-                    float r̄ = (P.r + C.r) * 0.5f;
-                    float Δr = P.r - C.r;
-                    float d2 = (dθ * r̄)*(dθ * r̄) + (Δr * Δr);
-                    float F = std::exp(-d2 / (2 * sigma[o] * sigma[o]));
-                    
-                    // Get current color of the orb 
-                    led_color_t base = orbPtr->color;
-                    
+                polar_t C = orbs[o]->GetOrigin();
+                // intensity folded into the weights, Q8.8
+                gaussian_falloff_q8(C.theta, C.r, sigma[o], intensity[o], F);
+
+                // Get current color of the orb 
+                led_color_t base = orbs[o]->color;
+
+                // only the rings the orb can reach
+                for (int i = F.begin; i < F.end; ++i) {
+                    if (F.w[i] == 0) continue;
                     // Apply intensity and falloff
-                    led_color_t contrib = base * (intensity[o] * F);
-                    
+                    led_color_t contrib = scale_q8(base, F.w[i]);
+
                     // Additive blend (clamped at 255)
-                    leds[i] = leds[i] + contrib;
+                    led_color_t& out = leds[led_geometry[i].strip];
+                    out = out + contrib;
                 }
             }
         }
         
-    private:
         std::array<HSV, 3> hsv_from;
         std::array<HSV, 3> hsv_to;
         std::vector<std::unique_ptr<Orb>> orbs;
@@ -1038,6 +990,5 @@ private:
         Phase phase;
         float t_phase;
         float dt;
-        std::chrono::time_point<std::chrono::high_resolution_clock> last_update;
-        std::chrono::time_point<std::chrono::high_resolution_clock> phase_start_time;
+        render_time_t phase_start_time{};
     };
\ No newline at end of file
@@ -0,0 +1,118 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+#include "led_color.h"
+#include "led_geometry.h"
+
+/*
+output stage, the last thing a frame goes through before it's published.
+global brightness and per ring gain (the outer rings are brighter /
+dimmer than the rest on the board) and gamma are baked into one 256 entry
+LUT per ring holding 8.8 fixed point output, so every channel is a single
+lookup. the 8 fractional bits aren't thrown away: an ordered temporal
+dither adds one of four thresholds before rounding, cycling frame by
+frame, so a channel that should be 1.75 comes out 2,2,1,2 and averages
+out right (to a quarter step). that's what keeps slow fades near black
+from banding. the output only depends on the input frame and the frame
+number mod 4, so a looping animation still puts out a short cycle of
+exact repeats and the encoded frame cache (led_tx_cache.h) keeps working
+with dithering on. the LUTs only get rebuilt when a parameter changes,
+Apply() is ~180 lookups and adds otherwise.
+*/
+
+#define LED_OUTPUT_DEFAULT_GAMMA 1.0f   // colours in the animations were picked without gamma
+#define LED_DITHER_PERIOD 4             // frames in the dither cycle
+
+// 8.8 rounding thresholds, one per frame of the cycle, spread so the
+// quarters come out as evenly as they can
+static constexpr uint8_t led_dither_thresholds[LED_DITHER_PERIOD] = {32, 160, 96, 224};
+
+// brightness correction per ring, logical ring order (0 = centre)
+static constexpr float led_output_default_gains[5] = {1.f, 1.f, 1.f, 1.66f, 0.37f};
+
+class LEDOutputStage {
+public:
+    LEDOutputStage() {
+        for (int ring = 0; ring < 5; ++ring) gains[ring].store(led_output_default_gains[ring], std::memory_order_relaxed);
+    }
+
+    // Any thread, picked up by the next Apply().
+    void SetRingGain(int ring, float gain) {
+        if (ring < 0 || ring >= 5) return;
+        gains[ring].store(std::max(0.0f, gain), std::memory_order_relaxed);
+        generation.fetch_add(1, std::memory_order_release);
+    }
+    void SetGamma(float g) {
+        gamma.store(std::max(0.1f, g), std::memory_order_relaxed);
+        generation.fetch_add(1, std::memory_order_release);
+    }
+    void SetBrightness(float b) {
+        brightness.store(std::min(1.0f, std::max(0.0f, b)), std::memory_order_relaxed);
+        generation.fetch_add(1, std::memory_order_release);
+    }
+    void SetDither(bool on) {
+        dither.store(on, std::memory_order_relaxed);
+        generation.fetch_add(1, std::memory_order_release);
+    }
+    float RingGain(int ring) const { return gains[ring].load(std::memory_order_relaxed); }
+    float Gamma() const { return gamma.load(std::memory_order_relaxed); }
+    float Brightness() const { return brightness.load(std::memory_order_relaxed); }
+    bool Dither() const { return dither.load(std::memory_order_relaxed); }
+    // Bumped on every parameter change, anything caching output frames keys on it.
+    uint32_t Generation() const { return generation.load(std::memory_order_acquire); }
+
+    // Render thread. Linear strip-ordered frame in, calibrated frame out, in place.
+    void Apply(LEDArray& frame) {
+        uint32_t gen = generation.load(std::memory_order_acquire);
+        if (gen != built) {
+            rebuild();
+            built = gen;
+        }
+        uint8_t* px = &frame[0].r;
+        // neighbouring channels sit at different points of the cycle so they
+        // don't all step up on the same frame
+        const uint32_t phase = dithering ? dither_frame++ : 0;
+        for (int ring = 0; ring < 5; ++ring) {
+            const ring_layout_t& l = ring_layout[ring];
+            const uint16_t* table = lut[ring].data();
+            const int begin = l.phys_start * 3, end = begin + l.size * 3;
+            if (dithering) {
+                for (int i = begin; i < end; ++i)   // <= 0xff00 + 224, no clamp needed
+                    px[i] = static_cast<uint8_t>((table[px[i]] + led_dither_thresholds[(phase + i) % LED_DITHER_PERIOD]) >> 8);
+            } else {
+                for (int i = begin; i < end; ++i)
+                    px[i] = static_cast<uint8_t>(std::min<uint32_t>(255, (table[px[i]] + 128u) >> 8));
+            }
+        }
+    }
+
+private:
+    void rebuild() {
+        const float g = gamma.load(std::memory_order_relaxed);
+        const float b = brightness.load(std::memory_order_relaxed);
+        dithering = dither.load(std::memory_order_relaxed);
+        for (int ring = 0; ring < 5; ++ring) {
+            const float gain = b * gains[ring].load(std::memory_order_relaxed);
+            for (int v = 0; v < 256; ++v) {
+                float out = 255.0f * 256.0f * gain * std::pow(v / 255.0f, g);
+                lut[ring][v] = static_cast<uint16_t>(std::min(255.0f * 256.0f, out + 0.5f));
+            }
+        }
+    }
+
+    std::array<std::atomic<float>, 5> gains;
+    std::atomic<float> gamma{LED_OUTPUT_DEFAULT_GAMMA};
+    std::atomic<float> brightness{1.0f};
+    std::atomic<bool> dither{true};
+    std::atomic<uint32_t> generation{1};
+
+    // render thread only
+    uint32_t built = 0;
+    bool dithering = true;
+    std::array<std::array<uint16_t, 256>, 5> lut{};          // 8.8 output per 8 bit input
+    uint32_t dither_frame = 0;                                // frames dithered so far
+};
@@ -0,0 +1,434 @@
+// led_render: renders animations offline, no board or /dev/spidev needed
+//
+//   led_render glow orb:speed=120,color=ff8000
+//   led_render --format png --size 96 --fps 25 --duration 2 glow:color=ff0000,min=190505
+//   led_render --format rgb --out /tmp orb
+//
+// Every argument that isn't an option is one animation, name[:key=value,...].
+// Each one is rendered into <out>/<name>_<params>.<gif|png|rgb>:
+//   gif  animated ring layout, loops (exact colours, one palette per frame)
+//   png  sprite sheet of the ring layout, frames left to right, top to bottom
+//   rgb  raw frames as the strip gets them, LED_COUNT * 3 bytes each (same as LED_SINK)
+// The duration defaults to one cycle for periodic animations, so gifs loop
+// seamlessly, 3 s otherwise. Animations, and the frames of each, render in
+// parallel across -j threads. Render time is synthetic, same output every run.
+
+#include "led_color.h"
+#include "led_geometry.h"
+#include "led_gif.h"
+#include "led_render.h"
+#include "led_matrix.h"
+#include "led_output.h"
+#include "rotating_orb_anim.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <zlib.h>
+
+using param_map_t = std::map<std::string, std::string>;
+
+struct render_options_t {
+    std::string format = "gif";
+    std::string out_dir = ".";
+    int width = 128, height = 128;
+    float fps = 50.0f;
+    float duration = 0.0f;         // 0 = one cycle, or 3 s
+    int columns = 0;               // sprite sheet, 0 = square-ish
+    int threads = 0;               // 0 = every core
+    bool calibrated = false;       // run frames through the output stage (gains, gamma)
+};
+
+struct render_job_t {
+    std::string spec;
+    std::string name;
+    param_map_t params;
+    std::unique_ptr<Animatable> animation;
+    std::vector<LEDArray> frames;
+    std::vector<std::vector<uint8_t>> images;   // rgb per frame, or an encoded gif frame
+    std::string path;
+    bool ok = true;
+};
+
+// ─── animations ──────────────────────────────────────────────────
+static bool parse_color(const std::string& s, led_color_t& out) {
+    char* end = nullptr;
+    unsigned long rgb = std::strtoul(s.c_str(), &end, 16);
+    if (s.size() != 6 || *end) return false;
+    out = { static_cast<uint8_t>(rgb >> 16), static_cast<uint8_t>(rgb >> 8), static_cast<uint8_t>(rgb) };
+    return true;
+}
+
+struct param_reader_t {
+    const param_map_t& params;
+    bool ok = true;
+
+    led_color_t color(const char* key, led_color_t def) {
+        auto it = params.find(key);
+        if (it == params.end()) return def;
+        led_color_t c;
+        if (!parse_color(it->second, c)) {
+            fprintf(stderr, "[led_render] Error: %s=%s isn't rrggbb\n", key, it->second.c_str());
+            ok = false;
+        }
+        return c;
+    }
+    float number(const char* key, float def) {
+        auto it = params.find(key);
+        if (it == params.end()) return def;
+        char* end = nullptr;
+        float v = std::strtof(it->second.c_str(), &end);
+        if (*end || it->second.empty()) {
+            fprintf(stderr, "[led_render] Error: %s=%s isn't a number\n", key, it->second.c_str());
+            ok = false;
+        }
+        return v;
+    }
+};
+
+// defaults are the ones the states use (led_state_machine.h)
+static const struct {
+    const char* name;
+    const char* help;
+    std::function<std::unique_ptr<Animatable>(param_reader_t&)> make;
+} animations[] = {
+    { "orb", "color bg speed sigma intensity", [](param_reader_t& p) -> std::unique_ptr<Animatable> {
+        return std::make_unique<tfw::RotatingOrbAnimator>(rgb2hsv(p.color("color", {0, 0, 255})), p.color("bg", {200, 200, 220}),
+                                                          p.number("speed", 300.0f), p.number("sigma", 3.5f),
+                                                          p.number("intensity", 1.2f));
+    }},
+    { "glow", "color min size", [](param_reader_t& p) -> std::unique_ptr<Animatable> {
+        int size = static_cast<int>(p.number("size", 5));
+        if (size < 3 || size > 5) {
+            fprintf(stderr, "[led_render] Error: glow size is 3..5\n");
+            p.ok = false;
+            return nullptr;
+        }
+        return std::make_unique<Glow>(size, p.color("color", {40, 120, 255}), p.color("min", {5, 5, 10}));
+    }},
+    { "loader", "color duration(ms)", [](param_reader_t& p) -> std::unique_ptr<Animatable> {
+        return std::make_unique<Loader>(p.color("color", {20, 150, 40}), static_cast<uint32_t>(p.number("duration", 3000)));
+    }},
+    { "spiral", "from to duration(s)", [](param_reader_t& p) -> std::unique_ptr<Animatable> {
+        HSV a = rgb2hsv(p.color("from", {255, 0, 0}));
+        HSV b = rgb2hsv(p.color("to", {0, 0, 255}));
+        auto palette = [](HSV c) {
+            return std::array<HSV, 3>{ c, HSV{std::fmod(c.h + 120.0f, 360.0f), c.s, c.v}, HSV{std::fmod(c.h + 240.0f, 360.0f), c.s, c.v} };
+        };
+        return std::make_unique<TransitionSpiral>(palette(a), palette(b), p.number("duration", 1.8f));
+    }},
+};
+
+static bool parse_spec(render_job_t& job) {
+    size_t colon = job.spec.find(':');
+    job.name = job.spec.substr(0, colon);
+    if (colon != std::string::npos) {
+        std::string rest = job.spec.substr(colon + 1);
+        size_t pos = 0;
+        while (pos <= rest.size()) {
+            size_t comma = rest.find(',', pos);
+            std::string kv = rest.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+            size_t eq = kv.find('=');
+            if (eq == std::string::npos || eq == 0) {
+                fprintf(stderr, "[led_render] Error: '%s' in '%s' isn't key=value\n", kv.c_str(), job.spec.c_str());
+                return false;
+            }
+            job.params[kv.substr(0, eq)] = kv.substr(eq + 1);
+            if (comma == std::string::npos) break;
+            pos = comma + 1;
+        }
+    }
+    for (const auto& a : animations) {
+        if (job.name != a.name) continue;
+        param_reader_t reader{job.params};
+        job.animation = a.make(reader);
+        return reader.ok && job.animation;
+    }
+    fprintf(stderr, "[led_render] Error: unknown animation '%s'\n", job.name.c_str());
+    return false;
+}
+
+// glow_color-ff0000_min-190505
+static std::string file_stem(const render_job_t& job) {
+    std::string stem = job.name;
+    for (const auto& kv : job.params) {
+        stem += '_' + kv.first + '-' + kv.second;
+    }
+    for (char& c : stem)
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '-' && c != '.') c = '-';
+    return stem;
+}
+
+// ─── rasterizing ─────────────────────────────────────────────────
+static const led_color_t board_color = {24, 24, 24};
+
+// One led = one flat disc at its place on the board, hard edges so a frame
+// has at most LED_COUNT + 1 colours.
+static void rasterize(const LEDArray& frame, int w, int h, uint8_t* rgb, size_t stride) {
+    for (int y = 0; y < h; ++y) {
+        uint8_t* row = rgb + y * stride;
+        for (int x = 0; x < w; ++x) {
+            row[x * 3] = board_color.r; row[x * 3 + 1] = board_color.g; row[x * 3 + 2] = board_color.b;
+        }
+    }
+    const float unit = std::min(w, h) * 0.5f / 4.6f;   // ring spacing in pixels
+    const float radius = unit * 0.38f;
+    const float cx = w * 0.5f, cy = h * 0.5f;
+    for (const led_geometry_t& g : led_geometry) {
+        const float px = cx + g.x * unit, py = cy - g.y * unit;
+        const led_color_t c = frame[g.strip];
+        int x0 = std::max(0, static_cast<int>(px - radius)), x1 = std::min(w - 1, static_cast<int>(px + radius + 1));
+        int y0 = std::max(0, static_cast<int>(py - radius)), y1 = std::min(h - 1, static_cast<int>(py + radius + 1));
+        for (int y = y0; y <= y1; ++y) {
+            for (int x = x0; x <= x1; ++x) {
+                float dx = x + 0.5f - px, dy = y + 0.5f - py;
+                if (dx * dx + dy * dy > radius * radius) continue;
+                uint8_t* p = rgb + y * stride + x * 3;
+                p[0] = c.r; p[1] = c.g; p[2] = c.b;
+            }
+        }
+    }
+}
+
+// ─── gif ─────────────────────────────────────────────────────────
+static void put16(std::vector<uint8_t>& out, int v) {
+    out.push_back(static_cast<uint8_t>(v));
+    out.push_back(static_cast<uint8_t>(v >> 8));
+}
+
+// One self contained gif frame: delay, local palette, image data.
+static std::vector<uint8_t> gif_frame(const std::vector<uint8_t>& rgb, int w, int h, int delay_cs) {
+    std::vector<uint8_t> palette(256 * 3, 0);
+    std::unordered_map<uint32_t, uint8_t> lookup;
+    std::vector<uint8_t> indices(static_cast<size_t>(w) * h);
+    for (size_t i = 0; i < indices.size(); ++i) {
+        uint32_t c = (rgb[i * 3] << 16) | (rgb[i * 3 + 1] << 8) | rgb[i * 3 + 2];
+        auto it = lookup.find(c);
+        if (it == lookup.end()) {
+            // can't overflow, rasterize() draws LED_COUNT + 1 colours at most
+            uint8_t idx = static_cast<uint8_t>(lookup.size());
+            palette[idx * 3] = rgb[i * 3]; palette[idx * 3 + 1] = rgb[i * 3 + 1]; palette[idx * 3 + 2] = rgb[i * 3 + 2];
+            it = lookup.emplace(c, idx).first;
+        }
+        indices[i] = it->second;
+    }
+
+    std::vector<uint8_t> out = {0x21, 0xf9, 0x04, 0x00};   // graphic control, no disposal
+    put16(out, delay_cs);
+    out.push_back(0);       // no transparency
+    out.push_back(0);
+    out.push_back(0x2c);    // image descriptor
+    put16(out, 0); put16(out, 0); put16(out, w); put16(out, h);
+    out.push_back(0x87);    // local colour table, 256 entries
+    out.insert(out.end(), palette.begin(), palette.end());
+    gif_lzw(indices, out);
+    return out;
+}
+
+static bool write_file(const std::string& path, const std::vector<std::vector<uint8_t>>& chunks) {
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) {
+        fprintf(stderr, "[led_render] Error: can't write '%s' (%s)\n", path.c_str(), std::strerror(errno));
+        return false;
+    }
+    bool ok = true;
+    for (const auto& c : chunks) ok = ok && std::fwrite(c.data(), 1, c.size(), f) == c.size();
+    ok = std::fclose(f) == 0 && ok;
+    if (!ok) fprintf(stderr, "[led_render] Error: writing '%s' failed\n", path.c_str());
+    return ok;
+}
+
+static bool write_gif(const render_job_t& job, int w, int h) {
+    std::vector<uint8_t> head = {'G', 'I', 'F', '8', '9', 'a'};
+    put16(head, w); put16(head, h);
+    head.insert(head.end(), {0x00, 0x00, 0x00});   // no global colour table
+    const char* loop = "\x21\xff\x0bNETSCAPE2.0\x03\x01\x00\x00\x00";
+    head.insert(head.end(), loop, loop + 19);
+    std::vector<std::vector<uint8_t>> chunks;
+    chunks.push_back(std::move(head));
+    chunks.insert(chunks.end(), job.images.begin(), job.images.end());
+    chunks.push_back({0x3b});
+    return write_file(job.path, chunks);
+}
+
+// ─── png ─────────────────────────────────────────────────────────
+static void png_chunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, size_t len) {
+    for (int s = 24; s >= 0; s -= 8) out.push_back(static_cast<uint8_t>(len >> s));
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data, data + len);
+    uLong crc = crc32(0, out.data() + start, static_cast<uInt>(len + 4));
+    for (int s = 24; s >= 0; s -= 8) out.push_back(static_cast<uint8_t>(crc >> s));
+}
+
+static bool write_png_sheet(const render_job_t& job, int w, int h, int columns) {
+    const int n = static_cast<int>(job.images.size());
+    const int cols = std::max(1, std::min(n, columns > 0 ? columns : static_cast<int>(std::ceil(std::sqrt(n)))));
+    const int rows = (n + cols - 1) / cols;
+    const int sheet_w = cols * w, sheet_h = rows * h;
+    const size_t row_bytes = 1 + static_cast<size_t>(sheet_w) * 3;   // filter byte + rgb
+
+    std::vector<uint8_t> raw(row_bytes * sheet_h, 0);
+    for (int f = 0; f < n; ++f) {
+        const int x0 = (f % cols) * w, y0 = (f / cols) * h;
+        for (int y = 0; y < h; ++y)
+            std::memcpy(&raw[(y0 + y) * row_bytes + 1 + x0 * 3], &job.images[f][y * w * 3], w * 3);
+    }
+    uLongf packed_len = compressBound(raw.size());
+    std::vector<uint8_t> packed(packed_len);
+    if (compress2(packed.data(), &packed_len, raw.data(), raw.size(), 6) != Z_OK) {
+        fprintf(stderr, "[led_render] Error: compressing '%s' failed\n", job.path.c_str());
+        return false;
+    }
+
+    std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    uint8_t ihdr[13] = {};
+    for (int i = 0; i < 4; ++i) {
+        ihdr[i] = static_cast<uint8_t>(sheet_w >> (24 - 8 * i));
+        ihdr[4 + i] = static_cast<uint8_t>(sheet_h >> (24 - 8 * i));
+    }
+    ihdr[8] = 8;    // bits per channel
+    ihdr[9] = 2;    // rgb
+    png_chunk(png, "IHDR", ihdr, sizeof(ihdr));
+    png_chunk(png, "IDAT", packed.data(), packed_len);
+    png_chunk(png, "IEND", nullptr, 0);
+    return write_file(job.path, {png});
+}
+
+static bool write_raw(const render_job_t& job) {
+    std::vector<uint8_t> raw;
+    raw.reserve(job.frames.size() * sizeof(LEDArray));
+    for (const LEDArray& frame : job.frames)
+        for (const led_color_t& c : frame) raw.insert(raw.end(), {c.r, c.g, c.b});
+    return write_file(job.path, {raw});
+}
+
+// ─── driver ──────────────────────────────────────────────────────
+static void parallel_for(size_t count, int threads, const std::function<void(size_t)>& fn) {
+    std::atomic<size_t> next{0};
+    auto worker = [&] {
+        for (size_t i; (i = next.fetch_add(1)) < count;) fn(i);
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1; t < std::min<int>(threads, static_cast<int>(count)); ++t) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+}
+
+static void usage() {
+    fprintf(stderr,
+            "usage: led_render [options] name[:key=value,...] ...\n"
+            "  --format gif|png|rgb   animated gif, png sprite sheet or raw strip frames (gif)\n"
+            "  --out DIR              where the files go (.)\n"
+            "  --size W[xH]           pixels per frame (128)\n"
+            "  --fps N                (50)\n"
+            "  --duration S           seconds, default one cycle if the animation loops, else 3\n"
+            "  --columns N            sprite sheet columns\n"
+            "  --calibrated           apply the default ring gains / gamma like the strip does\n"
+            "  -j N                   threads (all cores)\n"
+            "animations:\n");
+    for (const auto& a : animations) fprintf(stderr, "  %-8s %s\n", a.name, a.help);
+}
+
+int main(int argc, char** argv) {
+    render_options_t opt;
+    std::vector<render_job_t> jobs;
+    for (int arg = 1; arg < argc; ++arg) {
+        std::string a = argv[arg];
+        bool has_value = arg + 1 < argc;
+        if (a == "-h" || a == "--help") { usage(); return 0; }
+        else if (a == "--format" && has_value) opt.format = argv[++arg];
+        else if (a == "--out" && has_value) opt.out_dir = argv[++arg];
+        else if (a == "--fps" && has_value) opt.fps = std::strtof(argv[++arg], nullptr);
+        else if (a == "--duration" && has_value) opt.duration = std::strtof(argv[++arg], nullptr);
+        else if (a == "--columns" && has_value) opt.columns = std::atoi(argv[++arg]);
+        else if (a == "-j" && has_value) opt.threads = std::atoi(argv[++arg]);
+        else if (a == "--calibrated") opt.calibrated = true;
+        else if (a == "--size" && has_value) {
+            if (std::sscanf(argv[++arg], "%dx%d", &opt.width, &opt.height) == 1) opt.height = opt.width;
+        } else if (!a.empty() && a[0] == '-') {
+            usage();
+            return 1;
+        } else {
+            jobs.emplace_back();
+            jobs.back().spec = a;
+        }
+    }
+    if (jobs.empty() || opt.fps <= 0.0f || opt.width < 8 || opt.height < 8
+        || (opt.format != "gif" && opt.format != "png" && opt.format != "rgb")) {
+        usage();
+        return 1;
+    }
+    for (auto& job : jobs) {
+        if (!parse_spec(job)) return 1;
+        job.path = opt.out_dir + "/" + file_stem(job) + "." + opt.format;
+    }
+    const int threads = opt.threads > 0 ? opt.threads : std::max(1u, std::thread::hardware_concurrency());
+    const int w = opt.width, h = opt.height;
+    auto t0 = render_clock::now();
+
+    // 1. led frames, animations are stateful so each one renders in order
+    parallel_for(jobs.size(), threads, [&](size_t j) {
+        render_job_t& job = jobs[j];
+        const float period = std::fabs(job.animation->Period());
+        const float duration = opt.duration > 0.0f ? opt.duration : period > 0.0f ? period : 3.0f;
+        const size_t count = std::max<size_t>(1, static_cast<size_t>(std::lround(duration * opt.fps)));
+        LEDOutputStage output;
+        output.SetDither(false);
+        job.frames.resize(count);
+        for (size_t k = 0; k < count; ++k) {
+            auto t = render_time_t(std::chrono::duration_cast<render_clock::duration>(std::chrono::duration<double>(k / opt.fps)));
+            job.frames[k].fill({0, 0, 0});
+            job.animation->Render(t, job.frames[k]);
+            if (opt.calibrated) output.Apply(job.frames[k]);
+        }
+        job.images.resize(opt.format == "rgb" ? 0 : count);
+    });
+
+    // 2. every frame of every animation is independent from here on
+    std::vector<std::pair<size_t, size_t>> tasks;
+    for (size_t j = 0; j < jobs.size(); ++j)
+        for (size_t k = 0; k < jobs[j].images.size(); ++k) tasks.emplace_back(j, k);
+    parallel_for(tasks.size(), threads, [&](size_t i) {
+        render_job_t& job = jobs[tasks[i].first];
+        const size_t k = tasks[i].second;
+        std::vector<uint8_t> rgb(static_cast<size_t>(w) * h * 3);
+        rasterize(job.frames[k], w, h, rgb.data(), static_cast<size_t>(w) * 3);
+        if (opt.format == "gif") {
+            // centiseconds, rounded so the total stays exact
+            int delay = static_cast<int>(std::lround((k + 1) * 100.0 / opt.fps) - std::lround(k * 100.0 / opt.fps));
+            job.images[k] = gif_frame(rgb, w, h, std::max(1, delay));
+        } else {
+            job.images[k] = std::move(rgb);
+        }
+    });
+
+    // 3. files
+    parallel_for(jobs.size(), threads, [&](size_t j) {
+        render_job_t& job = jobs[j];
+        if (opt.format == "gif") job.ok = write_gif(job, w, h);
+        else if (opt.format == "png") job.ok = write_png_sheet(job, w, h, opt.columns);
+        else job.ok = write_raw(job);
+    });
+
+    bool ok = true;
+    for (const auto& job : jobs) {
+        if (job.ok) printf("[led_render] %s: %zu frames -> %s\n", job.spec.c_str(), job.frames.size(), job.path.c_str());
+        ok = ok && job.ok;
+    }
+    printf("[led_render] %zu animation(s) in %.1f ms on %d thread(s)\n", jobs.size(),
+           std::chrono::duration<double, std::milli>(render_clock::now() - t0).count(), threads);
+    return ok ? 0 : 1;
+}
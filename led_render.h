@@ -0,0 +1,72 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+#include "led_color.h"
+
+/*
+what every animation renders through: Animatable::Render(t, out).
+t is the only notion of time an animation gets, there are no clock reads
+inside, so the render thread, a cache or an offline renderer can all drive
+the same object. render_time_t uses the steady clock's epoch, which is
+CLOCK_MONOTONIC, same as FrameClock::now_ns().
+*/
+
+using render_clock = std::chrono::steady_clock;
+using render_time_t = render_clock::time_point;
+
+inline render_time_t render_time_from_ns(int64_t ns) {
+    return render_time_t(std::chrono::duration_cast<render_clock::duration>(std::chrono::nanoseconds(ns)));
+}
+inline int64_t render_time_ns(render_time_t t) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+}
+// seconds from a to b
+inline float render_seconds(render_time_t a, render_time_t b) {
+    return std::chrono::duration<float>(b - a).count();
+}
+
+// Non-owning view of a frame in strip order (std::span is C++20). Renders
+// write LED_COUNT leds into it.
+struct led_span_t {
+    led_color_t* ptr = nullptr;
+    size_t count = 0;
+
+    led_span_t() = default;
+    led_span_t(led_color_t* ptr, size_t count) : ptr(ptr), count(count) {}
+    led_span_t(LEDArray& frame) : ptr(frame.data()), count(frame.size()) {}
+
+    led_color_t* data() const { return ptr; }
+    size_t size() const { return count; }
+    led_color_t& operator[](size_t i) const { return ptr[i]; }
+    led_color_t* begin() const { return ptr; }
+    led_color_t* end() const { return ptr + count; }
+    void fill(led_color_t c) const { std::fill(ptr, ptr + count, c); }
+    void copy_from(const LEDArray& frame) const {
+        std::copy(frame.begin(), frame.begin() + std::min(count, frame.size()), ptr);
+    }
+};
+
+// FNV-1a over an animation's parameters, for Animatable::ParamHash().
+//   return param_hasher("glow").add(base_color).add(min_color).value();
+struct param_hasher {
+    uint64_t h = 1469598103934665603ull;
+
+    explicit param_hasher(const char* tag) { add_bytes(tag, std::strlen(tag)); }
+    template <typename T>
+    param_hasher& add(const T& v) {
+        static_assert(std::is_trivially_copyable<T>::value, "hash plain values only");
+        add_bytes(&v, sizeof(v));
+        return *this;
+    }
+    uint64_t value() const { return h; }
+
+private:
+    void add_bytes(const void* data, size_t len) {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < len; ++i) h = (h ^ p[i]) * 1099511628211ull;
+    }
+};
@@ -0,0 +1,211 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <atomic>
+#include <string>
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "led_color.h"
+#include "frame_clock.h"
+
+/*
+shared memory frame ring for external producers (audio visuals etc).
+POSIX shm object holding a small ring of LEDArray frames, strip order,
+linear colours (ring gains and gamma still get applied on the way out).
+one producer writes slot after slot, each slot is a seqlock (odd seq =
+being written), the header counts published frames. the consumer only
+ever looks at the newest frame and never waits: if the seq moved while
+copying the frame is torn and dropped, if the newest frame is older than
+max_age the producer is considered gone and the layer goes transparent.
+the producer never waits for the consumer either.
+*/
+
+#define LED_SHM_DEFAULT_NAME "/tfw-led-frames"
+#define LED_SHM_MAGIC 0x4c454446u   // "LEDF"
+#define LED_SHM_VERSION 1
+#define LED_SHM_SLOTS 4
+
+struct led_shm_slot_t {
+    std::atomic<uint32_t> seq;
+    uint32_t reserved;
+    int64_t timestamp_ns;             // CLOCK_MONOTONIC at publish
+    LEDArray frame;
+};
+
+struct led_shm_ring_t {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slots;
+    uint32_t frame_bytes;
+    std::atomic<uint64_t> published;  // frames published so far, newest is slot (published - 1) % slots
+    alignas(64) led_shm_slot_t slot[LED_SHM_SLOTS];
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free,
+              "shm ring atomics have to be lock free to work across processes");
+
+// Maps the ring, shared by producer and consumer.
+class LEDShmMapping {
+public:
+    LEDShmMapping() = default;
+    LEDShmMapping(const LEDShmMapping&) = delete;
+    LEDShmMapping& operator=(const LEDShmMapping&) = delete;
+    ~LEDShmMapping() { Close(); }
+
+    // create: make (or reset) the object, the consumer side does this.
+    bool Open(const std::string& name, bool create) {
+        Close();
+        int fd = shm_open(name.c_str(), create ? (O_RDWR | O_CREAT) : O_RDWR, 0666);
+        if (fd < 0) {
+            printf("[LEDShm] Error: shm_open '%s' failed (%s) \n", name.c_str(), std::strerror(errno));
+            return false;
+        }
+        if (create) {
+            fchmod(fd, 0666); // umask would lock other services out
+            if (ftruncate(fd, sizeof(led_shm_ring_t)) < 0) {
+                printf("[LEDShm] Error: ftruncate failed (%s) \n", std::strerror(errno));
+                close(fd);
+                return false;
+            }
+        }
+        struct stat st;
+        if (fstat(fd, &st) < 0 || st.st_size < static_cast<off_t>(sizeof(led_shm_ring_t))) {
+            printf("[LEDShm] Error: '%s' is too small \n", name.c_str());
+            close(fd);
+            return false;
+        }
+        void* mem = mmap(nullptr, sizeof(led_shm_ring_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mem == MAP_FAILED) {
+            printf("[LEDShm] Error: mmap failed (%s) \n", std::strerror(errno));
+            return false;
+        }
+        ring = static_cast<led_shm_ring_t*>(mem);
+        if (create) {
+            std::memset(static_cast<void*>(ring), 0, sizeof(led_shm_ring_t));
+            ring->slots = LED_SHM_SLOTS;
+            ring->frame_bytes = sizeof(LEDArray);
+            ring->version = LED_SHM_VERSION;
+            std::atomic_thread_fence(std::memory_order_release);
+            ring->magic = LED_SHM_MAGIC;
+        } else if (ring->magic != LED_SHM_MAGIC || ring->version != LED_SHM_VERSION
+                   || ring->slots != LED_SHM_SLOTS || ring->frame_bytes != sizeof(LEDArray)) {
+            printf("[LEDShm] Error: '%s' has an unknown layout \n", name.c_str());
+            Close();
+            return false;
+        }
+        this->name = name;
+        return true;
+    }
+    void Close() {
+        if (ring) munmap(ring, sizeof(led_shm_ring_t));
+        ring = nullptr;
+    }
+    // Removes the name, mappings stay valid.
+    void Unlink() {
+        if (!name.empty()) shm_unlink(name.c_str());
+    }
+    bool ok() const { return ring != nullptr; }
+
+protected:
+    led_shm_ring_t* ring = nullptr;
+    std::string name;
+};
+
+// Producer side, single writer.
+class LEDShmProducer : public LEDShmMapping {
+public:
+    bool Open(const std::string& name = LED_SHM_DEFAULT_NAME) { return LEDShmMapping::Open(name, false); }
+
+    void Publish(const LEDArray& frame) {
+        if (!ring) return;
+        uint64_t n = ring->published.load(std::memory_order_relaxed);
+        led_shm_slot_t& slot = ring->slot[n % LED_SHM_SLOTS];
+        uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+        slot.seq.store(seq + 1, std::memory_order_relaxed);        // odd: writing
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.timestamp_ns = FrameClock::now_ns();
+        std::memcpy(&slot.frame, &frame, sizeof(LEDArray));
+        slot.seq.store(seq + 2, std::memory_order_release);        // even: done
+        ring->published.store(n + 1, std::memory_order_release);
+    }
+};
+
+// Consumer side, read by the render thread once per frame.
+class LEDShmConsumer : public LEDShmMapping {
+public:
+    bool Open(const std::string& name = LED_SHM_DEFAULT_NAME) { return LEDShmMapping::Open(name, true); }
+
+    // frames older than this count as "producer gone"
+    void SetMaxAge(std::chrono::milliseconds age) { max_age_ns = age.count() * 1000000ll; }
+
+    // Newest complete frame into `out`. False (and `out` untouched) when there
+    // is none, it's stale or it got overwritten while copying.
+    bool Read(LEDArray& out) {
+        int64_t ts;
+        if (!read_newest(ts)) return false;
+        out = scratch;
+        return true;
+    }
+
+    // What a layer should show: the newest frame, or the last good one when
+    // the newest was torn. False once nothing fresh is left.
+    bool Latest(LEDArray& out) {
+        int64_t ts;
+        if (read_newest(ts)) {
+            current = scratch;
+            current_ts = ts;
+        }
+        if (current_ts == 0 || FrameClock::now_ns() - current_ts > max_age_ns) return false;
+        out = current;
+        return true;
+    }
+
+    uint64_t Frames() const { return frames.load(std::memory_order_relaxed); }
+    uint64_t TornFrames() const { return torn.load(std::memory_order_relaxed); }
+    uint64_t StaleFrames() const { return stale.load(std::memory_order_relaxed); }
+
+private:
+    // newest slot into scratch
+    bool read_newest(int64_t& ts) {
+        if (!ring) return false;
+        uint64_t n = ring->published.load(std::memory_order_acquire);
+        if (n == 0) return false;
+        const led_shm_slot_t& slot = ring->slot[(n - 1) % LED_SHM_SLOTS];
+        uint32_t s1 = slot.seq.load(std::memory_order_acquire);
+        if (s1 & 1) {
+            torn.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        ts = slot.timestamp_ns;
+        std::memcpy(&scratch, &slot.frame, sizeof(LEDArray));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) != s1) {
+            torn.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if (FrameClock::now_ns() - ts > max_age_ns) {
+            if (n != last_seen) stale.fetch_add(1, std::memory_order_relaxed);
+            last_seen = n;
+            return false;
+        }
+        if (n != last_seen) frames.fetch_add(1, std::memory_order_relaxed);
+        last_seen = n;
+        return true;
+    }
+
+    int64_t max_age_ns = 250 * 1000000ll;
+    uint64_t last_seen = 0;
+    LEDArray scratch{};
+    LEDArray current{};
+    int64_t current_ts = 0;
+    std::atomic<uint64_t> frames{0};
+    std::atomic<uint64_t> torn{0};
+    std::atomic<uint64_t> stale{0};
+};
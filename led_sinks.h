@@ -0,0 +1,187 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <deque>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "led_color.h"
+#include "led_encode.h"
+#include "led_transport.h"
+
+/*
+hardware-free transports. the mem and file sinks decode the WS2812B stream
+back to rgb and check it, so the whole LEDManager pipeline (encode, tail,
+ring) can be run and verified on any linux box.
+*/
+
+#define LED_MEM_SINK_MAX_FRAMES 4096    // ~80 s at 50 fps, ~8 MB with the raw buffers
+
+// Decodes one transmit buffer back into colors. Fails if the buffer is short,
+// a symbol byte isn't WS2812B_HIGH/LOW, or the reset tail isn't all zeros.
+inline bool decode_ws2812b(const char* buf, uint32_t len, LEDArray& out) {
+    if (len < LED_FRAME_BYTES) return false;
+    auto channel = [](const char* sym, uint8_t& value) {
+        value = 0;
+        for (int k = 0; k < 8; k++) {
+            uint8_t s = static_cast<uint8_t>(sym[k]);
+            if (s == WS2812B_HIGH) value |= static_cast<uint8_t>(1 << (7 - k));
+            else if (s != WS2812B_LOW) return false;
+        }
+        return true;
+    };
+    for (int j = 0; j < LED_COUNT; j++) {
+        const char* led = buf + j * 24;
+        if (!channel(led, out[j].g) || !channel(led + 8, out[j].r) || !channel(led + 16, out[j].b))
+            return false;
+    }
+    for (uint32_t i = LED_FRAME_BYTES; i < len; i++) {
+        if (buf[i] != 0) return false;
+    }
+    return true;
+}
+
+// Keeps the last `max_frames` transmitted buffers and their decoded frames in
+// memory, older ones get dropped (a ring, so a long run can't grow without
+// bound). Meant for tests and benchmarks.
+struct mem_sink_t : led_transport_t {
+    explicit mem_sink_t(bool keep_raw = true, size_t max_frames = LED_MEM_SINK_MAX_FRAMES)
+        : keep_raw(keep_raw), max_frames(max_frames ? max_frames : 1) {}
+
+    bool ok() const override { return true; }
+    const char* name() const override { return "MemSink"; }
+
+    bool transfer(char* tx_buffer, uint32_t len) override {
+        LEDArray frame;
+        bool valid = decode_ws2812b(tx_buffer, len, frame);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (keep_raw) {
+            if (raw.size() == max_frames) raw.pop_front();
+            raw.emplace_back(tx_buffer, tx_buffer + len);
+        }
+        if (valid) {
+            if (frames.size() == max_frames) frames.pop_front();
+            frames.push_back(frame);
+            ++frame_count;
+        } else {
+            ++decode_errors;
+        }
+        return valid;
+    }
+
+    // the kept ones, oldest first
+    std::vector<LEDArray> Frames() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return std::vector<LEDArray>(frames.begin(), frames.end());
+    }
+    std::vector<std::vector<char>> RawBuffers() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return std::vector<std::vector<char>>(raw.begin(), raw.end());
+    }
+    // every frame decoded so far, dropped ones included
+    size_t FrameCount() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return frame_count;
+    }
+    size_t DecodeErrors() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return decode_errors;
+    }
+
+private:
+    bool keep_raw;
+    size_t max_frames;
+    mutable std::mutex mutex;
+    std::deque<std::vector<char>> raw;
+    std::deque<LEDArray> frames;
+    size_t frame_count = 0;
+    size_t decode_errors = 0;
+};
+
+// Writes each decoded frame as LED_COUNT packed rgb triplets to a file or FIFO
+// (a FIFO blocks in the constructor until a reader shows up). Once the FIFO's
+// reader goes away transfers fail with EPIPE until a new one opens it, the
+// process has to ignore SIGPIPE for that (main.cc does).
+struct file_sink_t : led_transport_t {
+    explicit file_sink_t(const std::string& path) : path(path) {
+        fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            printf("[FileSink] Error: failed to open '%s' (%s) \n", path.c_str(), std::strerror(errno));
+            return;
+        }
+        printf("[FileSink] Writing frames to '%s' \n", path.c_str());
+    }
+    ~file_sink_t() override {
+        if (fd >= 0) close(fd);
+    }
+
+    bool ok() const override { return fd >= 0; }
+    const char* name() const override { return "FileSink"; }
+
+    bool transfer(char* tx_buffer, uint32_t len) override {
+        LEDArray frame;
+        if (!decode_ws2812b(tx_buffer, len, frame)) {
+            ++decode_errors;
+            printf("[FileSink] Error: transmit buffer failed to decode \n");
+            return false;
+        }
+        uint8_t rgb[LED_COUNT * 3];
+        for (int j = 0; j < LED_COUNT; j++) {
+            rgb[j * 3]     = frame[j].r;
+            rgb[j * 3 + 1] = frame[j].g;
+            rgb[j * 3 + 2] = frame[j].b;
+        }
+        size_t off = 0;
+        while (off < sizeof(rgb)) {
+            ssize_t n = write(fd, rgb + off, sizeof(rgb) - off);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                if (errno == EPIPE) {
+                    // reader gone, frames get dropped until another one opens the FIFO
+                    if (!reader_gone) printf("[FileSink] Reader of '%s' went away, dropping frames \n", path.c_str());
+                    reader_gone = true;
+                    return false;
+                }
+                printf("[FileSink] Error: write failed (%s) \n", std::strerror(errno));
+                return false;
+            }
+            off += static_cast<size_t>(n);
+        }
+        if (reader_gone) printf("[FileSink] Reader of '%s' is back \n", path.c_str());
+        reader_gone = false;
+        ++frames_written;
+        return true;
+    }
+
+    size_t FramesWritten() const { return frames_written; }
+    size_t DecodeErrors() const { return decode_errors; }
+
+private:
+    std::string path;
+    int fd = -1;
+    bool reader_gone = false;     // output thread only
+    std::atomic<size_t> frames_written{0};
+    std::atomic<size_t> decode_errors{0};
+};
+
+// Drops every buffer, only counts them. For benchmarks.
+struct null_sink_t : led_transport_t {
+    bool ok() const override { return true; }
+    const char* name() const override { return "NullSink"; }
+
+    bool transfer(char*, uint32_t) override {
+        transfers.fetch_add(1, std::memory_order_release);
+        return true;
+    }
+
+    uint64_t Transfers() const { return transfers.load(std::memory_order_acquire); }
+
+private:
+    std::atomic<uint64_t> transfers{0};
+};
@@ -0,0 +1,317 @@
+#pragma once
+
+#include "led_color.h"
+#include "led_matrix.h"
+#include "led_compositor.h"
+#include "rotating_orb_anim.h"
+#include "ledmgr.h"
+#include "frame_clock.h"
+#include "led_input_rate.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+
+/*
+device states on top of LEDManager::Show().
+every state the app asks for is a "claim" with a priority and an optional
+timeout. the render thread looks at the claims once per frame and shows the
+highest priority live one, idle when there's none. SetState() only writes a
+few atomics, so events can come in at any rate from any thread: they just
+overwrite each other and the next frame sees the latest.
+*/
+
+namespace tfw {
+
+enum class LEDState : uint8_t {
+    Off = 0,
+    Idle,
+    Respond,
+    Error,
+    Typing,
+    Reasoning,
+    Loading,
+    ConnectToMe,
+    Connecting,
+    Connected,
+    Count
+};
+
+inline const char* led_state_name(LEDState state) {
+    static const char* const names[] = { "off", "idle", "respond", "error", "typing", "reasoning",
+                                         "loading", "connect_to_me", "connecting", "connected" };
+    return names[static_cast<int>(state)];
+}
+
+inline bool led_state_from_name(const char* name, LEDState& out) {
+    for (int s = 0; s < static_cast<int>(LEDState::Count); ++s) {
+        if (std::strcmp(name, led_state_name(static_cast<LEDState>(s))) == 0) {
+            out = static_cast<LEDState>(s);
+            return true;
+        }
+    }
+    return false;
+}
+
+struct LEDStateParams {
+    float speed = 0.0f;                                   // orb speed in deg/s, 0 = state default
+    bool has_color = false;                               // use `color` instead of the state's own
+    led_color_t color{};                                  // orb / glow colour
+    std::chrono::milliseconds timeout{-1};                // -1 = state default, 0 = until replaced
+};
+
+class LEDStateMachine {
+public:
+    // Shows the state's animation. Runs on the render thread.
+    using enter_fn = std::function<void(LEDManager& mgr, const LEDStateParams& params, std::chrono::milliseconds fade)>;
+    // Applies new params while the state stays on screen, optional. Same
+    // signature as enter_fn so a state can just re-enter.
+    using update_fn = enter_fn;
+    // Runs every frame while the state is on screen, optional.
+    using tick_fn = std::function<void(LEDManager& mgr, const LEDStateParams& params, int64_t now_ns)>;
+
+    struct StateConfig {
+        uint8_t priority = 0;                             // higher wins
+        std::chrono::milliseconds timeout{0};             // falls back once this runs out, 0 = never
+        enter_fn enter;
+        update_fn update;
+        tick_fn tick;
+    };
+
+    explicit LEDStateMachine(LEDManager& mgr) : mgr(mgr) {
+        for (auto& e : expiry_ns) e.store(0, std::memory_order_relaxed);
+        for (auto& s : claim_seq) s.store(0, std::memory_order_relaxed);
+        for (auto& s : speed) s.store(0.0f, std::memory_order_relaxed);
+        for (auto& c : color) c.store(0, std::memory_order_relaxed);
+        for (auto& s : param_seq) s.store(0, std::memory_order_relaxed);
+        load_defaults();
+    }
+    ~LEDStateMachine() { Stop(); }
+
+    // Replaces a state's config. Only before Start().
+    void Configure(LEDState state, StateConfig config) { configs[idx(state)] = std::move(config); }
+    void SetFade(std::chrono::milliseconds fade) { fade_ms.store(fade.count(), std::memory_order_relaxed); }
+
+    // Hooks into the manager's render thread and shows idle.
+    void Start() {
+        mgr.StopRendering();
+        active = LEDState::Count;
+        mgr.SetFrameHook([this](int64_t now) { on_frame(now); });
+        mgr.Show(nullptr);
+    }
+    void Stop() {
+        mgr.StopRendering();
+        mgr.SetFrameHook(nullptr);
+    }
+
+    // Non-blocking, thread-safe. Claims `state`, dropping every other claim of
+    // the same or lower priority; higher ones (e.g. an error) stay on top
+    // until they time out or get cleared.
+    void SetState(LEDState state, const LEDStateParams& params = {}) {
+        const int s = idx(state);
+        store_params(s, params);
+        claim(s, params.timeout);
+    }
+    // Non-blocking, allocation free, fine at hundreds of calls per second.
+    // Renews the typing claim (keeping its params) and feeds the keystroke
+    // rate that drives the orb speed unless a fixed speed param is set.
+    void Keystroke() { Keystroke(mgr.NowNs()); }
+    void Keystroke(int64_t ts_ns) {
+        typing_speed.Keystroke(ts_ns);
+        claim(idx(LEDState::Typing), std::chrono::milliseconds(-1));
+    }
+    // Changes a state's params without claiming it. Applies live if it's on
+    // screen, otherwise the next time it gets shown.
+    void SetParams(LEDState state, const LEDStateParams& params) {
+        store_params(idx(state), params);
+        mgr.RequestFrame();
+    }
+    // Drops the claim on `state`, whatever is below shows again.
+    void ClearState(LEDState state) {
+        expiry_ns[idx(state)].store(0, std::memory_order_release);
+        mgr.RequestFrame();
+    }
+    void ClearAll() {
+        for (auto& e : expiry_ns) e.store(0, std::memory_order_release);
+        mgr.RequestFrame();
+    }
+
+    // State on the strip right now.
+    LEDState State() const { return shown.load(std::memory_order_relaxed); }
+    // State changes so far. Nothing gets printed on the render thread, poll
+    // this (and State()) from elsewhere to log them.
+    uint64_t Transitions() const { return transitions.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr int STATE_COUNT = static_cast<int>(LEDState::Count);
+    static constexpr int64_t NO_EXPIRY = std::numeric_limits<int64_t>::max();
+    static int idx(LEDState state) { return static_cast<int>(state); }
+    static constexpr uint32_t COLOR_SET = 1u << 24;
+
+    void claim(int s, std::chrono::milliseconds timeout) {
+        const StateConfig& cfg = configs[s];
+        if (timeout.count() < 0) timeout = cfg.timeout;
+        int64_t expiry = timeout.count() > 0
+                       ? mgr.NowNs() + std::chrono::duration_cast<std::chrono::nanoseconds>(timeout).count()
+                       : NO_EXPIRY;
+        for (int t = 0; t < STATE_COUNT; ++t) {
+            if (t != s && configs[t].priority <= cfg.priority) expiry_ns[t].store(0, std::memory_order_relaxed);
+        }
+        claim_seq[s].store(next_seq.fetch_add(1, std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        expiry_ns[s].store(expiry, std::memory_order_release);
+        mgr.RequestFrame();
+    }
+
+    // repeating the same params isn't a change, so a flood of identical
+    // SetState() calls never restarts anything
+    void store_params(int s, const LEDStateParams& params) {
+        uint32_t c = params.has_color ? (COLOR_SET | (params.color.r << 16) | (params.color.g << 8) | params.color.b) : 0;
+        bool changed = speed[s].exchange(params.speed, std::memory_order_relaxed) != params.speed;
+        changed |= color[s].exchange(c, std::memory_order_relaxed) != c;
+        if (changed) param_seq[s].fetch_add(1, std::memory_order_release);
+    }
+    LEDStateParams load_params(int s) const {
+        LEDStateParams params;
+        params.speed = speed[s].load(std::memory_order_relaxed);
+        uint32_t c = color[s].load(std::memory_order_relaxed);
+        params.has_color = (c & COLOR_SET) != 0;
+        params.color = { static_cast<uint8_t>(c >> 16), static_cast<uint8_t>(c >> 8), static_cast<uint8_t>(c) };
+        return params;
+    }
+
+    // render thread
+    void on_frame(int64_t now) {
+        int best = -1;
+        uint64_t best_seq = 0;
+        for (int s = 0; s < STATE_COUNT; ++s) {
+            int64_t e = expiry_ns[s].load(std::memory_order_acquire);
+            if (e == 0) continue;
+            if (e <= now) {
+                // timed out, unless it was renewed in the meantime
+                expiry_ns[s].compare_exchange_strong(e, 0, std::memory_order_relaxed);
+                continue;
+            }
+            uint64_t seq = claim_seq[s].load(std::memory_order_relaxed);
+            if (best < 0 || configs[s].priority > configs[best].priority
+                || (configs[s].priority == configs[best].priority && seq > best_seq)) {
+                best = s;
+                best_seq = seq;
+            }
+        }
+        LEDState target = best < 0 ? LEDState::Idle : static_cast<LEDState>(best);
+        const int t = idx(target);
+        uint64_t seq = param_seq[t].load(std::memory_order_acquire);
+        LEDStateParams params = load_params(t);
+
+        if (target != active) {
+            active = target;
+            active_seq = seq;
+            shown.store(target, std::memory_order_relaxed);
+            transitions.fetch_add(1, std::memory_order_relaxed);
+            if (configs[t].enter) configs[t].enter(mgr, params, std::chrono::milliseconds(fade_ms.load(std::memory_order_relaxed)));
+            else mgr.Show(nullptr, std::chrono::milliseconds(fade_ms.load(std::memory_order_relaxed)));
+        } else if (seq != active_seq) {
+            // params changed while the state is up
+            active_seq = seq;
+            if (configs[t].update) configs[t].update(mgr, params, std::chrono::milliseconds(fade_ms.load(std::memory_order_relaxed)));
+        }
+        if (configs[t].tick) configs[t].tick(mgr, params, now);
+    }
+
+    // `driver` (optional) spins the orb at the keystroke rate whenever no
+    // fixed speed param is set
+    static StateConfig orb_state(uint8_t priority, std::chrono::milliseconds timeout, HSV orb, led_color_t bg,
+                                 float default_speed = 300.0f, TypingSpeed* driver = nullptr) {
+        auto orb_anim = std::make_shared<std::shared_ptr<RotatingOrbAnimator>>();
+        StateConfig cfg;
+        cfg.priority = priority;
+        cfg.timeout = timeout;
+        cfg.enter = [orb_anim, orb, bg, default_speed, driver](LEDManager& mgr, const LEDStateParams& p, std::chrono::milliseconds fade) {
+            float speed = p.speed > 0.0f ? p.speed : default_speed;
+            if (driver && p.speed <= 0.0f) {
+                int64_t now = mgr.NowNs();
+                driver->Restart(now);
+                speed = driver->Speed(now);
+            }
+            *orb_anim = std::make_shared<RotatingOrbAnimator>(p.has_color ? rgb2hsv(p.color) : orb, bg, speed);
+            mgr.Show(*orb_anim, fade);
+        };
+        // runs on the render thread too, so touching the orb colour is fine
+        cfg.update = [orb_anim, orb, default_speed, driver](LEDManager& mgr, const LEDStateParams& p, std::chrono::milliseconds) {
+            if (!*orb_anim) return;
+            if (!driver || p.speed > 0.0f) (*orb_anim)->setRotationSpeed(p.speed > 0.0f ? p.speed : default_speed);
+            else driver->Restart(mgr.NowNs(), (*orb_anim)->getRotationSpeed()); // ease back from the fixed speed
+            (*orb_anim)->setOrbColor(p.has_color ? rgb2hsv(p.color) : orb);
+        };
+        if (driver) {
+            cfg.tick = [orb_anim, driver](LEDManager&, const LEDStateParams& p, int64_t now) {
+                if (*orb_anim && p.speed <= 0.0f) (*orb_anim)->setRotationSpeed(driver->Speed(now));
+            };
+        }
+        return cfg;
+    }
+    static StateConfig glow_state(uint8_t priority, std::chrono::milliseconds timeout, led_color_t color, led_color_t min_color) {
+        StateConfig cfg;
+        cfg.priority = priority;
+        cfg.timeout = timeout;
+        cfg.enter = [color, min_color](LEDManager& mgr, const LEDStateParams& p, std::chrono::milliseconds fade) {
+            if (p.has_color) mgr.Show(std::make_shared<Glow>(5, p.color, p.color / 10.0f), fade);
+            else mgr.Show(std::make_shared<Glow>(5, color, min_color), fade);
+        };
+        // a glow can't change colour in place, fade over to a new one
+        cfg.update = cfg.enter;
+        return cfg;
+    }
+
+    // the states from the README, colours as in the old demo loop
+    void load_defaults() {
+        using std::chrono::milliseconds;
+        configs[idx(LEDState::Off)].priority = 0;
+        configs[idx(LEDState::Idle)] = glow_state(0, milliseconds(0), {40, 120, 255}, {5, 5, 10});
+        configs[idx(LEDState::Respond)] = glow_state(40, milliseconds(0), {255, 140, 0}, {10, 5, 0});
+        configs[idx(LEDState::Error)] = glow_state(100, milliseconds(5000), {255, 0, 0}, {25, 5, 5});
+        // typing spins with the keystroke rate and falls back to idle when the keystrokes stop
+        configs[idx(LEDState::Typing)] = orb_state(30, milliseconds(2000), {240.0f, 1.0f, 1.0f}, {200, 200, 220}, 90.0f,
+                                                   &typing_speed);
+        configs[idx(LEDState::Reasoning)] = orb_state(50, milliseconds(0), {0.0f, 0.0f, 1.0f}, {128, 128, 128});
+        configs[idx(LEDState::ConnectToMe)] = orb_state(20, milliseconds(0), {30.0f, 1.0f, 1.0f}, {0, 0, 0});
+        configs[idx(LEDState::Connecting)] = orb_state(20, milliseconds(0), {0.0f, 0.0f, 0.0f}, {255, 255, 255});
+        configs[idx(LEDState::Connected)] = orb_state(20, milliseconds(3000), {240.0f, 1.0f, 1.0f}, {0, 0, 0});
+
+        // loader ring over the idle glow
+        StateConfig& loading = configs[idx(LEDState::Loading)];
+        loading.priority = 60;
+        loading.timeout = milliseconds(0);
+        loading.enter = [](LEDManager& mgr, const LEDStateParams&, std::chrono::milliseconds fade) {
+            auto comp = std::make_shared<LEDCompositor>();
+            comp->AddLayer(std::make_shared<Glow>(5, led_color_t{40, 120, 255}, led_color_t{5, 5, 10}), BlendMode::Alpha, 0.6f);
+            comp->AddLayer(std::make_shared<Loader>(led_color_t{20, 150, 40}, 3000), BlendMode::Alpha);
+            mgr.Show(std::shared_ptr<Animatable>(comp), fade);
+        };
+    }
+
+    LEDManager& mgr;
+    std::array<StateConfig, STATE_COUNT> configs;
+    TypingSpeed typing_speed;                                    // Keystroke() -> typing orb speed
+    std::atomic<int64_t> fade_ms{400};
+
+    // claims, written by SetState() from any thread
+    std::array<std::atomic<int64_t>, STATE_COUNT> expiry_ns;     // 0 = not claimed
+    std::array<std::atomic<uint64_t>, STATE_COUNT> claim_seq;    // newest claim wins a priority tie
+    std::array<std::atomic<float>, STATE_COUNT> speed;
+    std::array<std::atomic<uint32_t>, STATE_COUNT> color;       // 0x01rrggbb when set
+    std::array<std::atomic<uint64_t>, STATE_COUNT> param_seq;   // bumped on every param write
+    std::atomic<uint64_t> next_seq{0};
+
+    // render thread only
+    LEDState active = LEDState::Count;
+    uint64_t active_seq = 0;
+    std::atomic<LEDState> shown{LEDState::Off};
+    std::atomic<uint64_t> transitions{0};
+};
+
+}
@@ -0,0 +1,713 @@
+// Frame pipeline tests: `make test`
+//
+// Exhaustive checks that don't fit the startup self-check: every encoder
+// path against the original bit-by-bit encoder over all 2^24 colors, the
+// whole LEDManager pipeline run into a mem sink and decoded back, the
+// frame and tx caches against uncached output, and led_render's gif LZW
+// stream run through a plain decoder.
+// Prints one line per case, exits non-zero if any case failed. Pass a
+// substring to only run matching cases.
+
+#include "ledmgr.h"
+#include "led_matrix.h"
+#include "led_color.h"
+#include "led_encode.h"
+#include "led_sinks.h"
+#include "led_gif.h"
+#include "led_clock.h"
+#include "led_frame_cache.h"
+#include "led_tx_cache.h"
+#include "rotating_orb_anim.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// ─── harness ─────────────────────────────────────────────────────
+struct TestCase {
+    const char* name;
+    std::function<bool()> fn;
+};
+
+static std::vector<TestCase>& registry() {
+    static std::vector<TestCase> cases;
+    return cases;
+}
+
+struct TestRegistrar {
+    TestRegistrar(const char* name, std::function<bool()> fn) {
+        registry().push_back({name, std::move(fn)});
+    }
+};
+
+#define TEST(fn) static TestRegistrar fn##_registrar(#fn, fn)
+
+// ─── reference encoder ───────────────────────────────────────────
+// the original encode_color, one symbol byte per bit, G R B, msb first
+static void reference_encode_color(uint8_t r, uint8_t g, uint8_t b, char* buffer) {
+    for (int i = 0; i < 8; i++) {
+        buffer[i]      = (g & (1 << (7 - i))) ? WS2812B_HIGH : WS2812B_LOW;
+        buffer[8 + i]  = (r & (1 << (7 - i))) ? WS2812B_HIGH : WS2812B_LOW;
+        buffer[16 + i] = (b & (1 << (7 - i))) ? WS2812B_HIGH : WS2812B_LOW;
+    }
+}
+
+static led_color_t color_at(uint32_t rgb) {
+    return { static_cast<uint8_t>(rgb >> 16), static_cast<uint8_t>(rgb >> 8), static_cast<uint8_t>(rgb) };
+}
+
+static void report_mismatch(const char* what, uint32_t rgb) {
+    led_color_t c = color_at(rgb);
+    printf("[led_test] %s: wrong symbols for rgb(%u,%u,%u)\n", what, c.r, c.g, c.b);
+}
+
+// Walks all 2^24 colors a frame of LED_COUNT at a time (the last frame wraps
+// back round to 0), handing `check` the frame plus its reference encoding.
+static bool for_all_colors(const std::function<bool(const LEDArray&, const char*, uint32_t)>& check) {
+    const uint32_t total = 1u << 24;
+    LEDArray frame;
+    alignas(32) static char want[LED_FRAME_BYTES];
+    for (uint32_t base = 0; base < total; base += LED_COUNT) {
+        for (int j = 0; j < LED_COUNT; j++) {
+            frame[j] = color_at((base + j) % total);
+            reference_encode_color(frame[j].r, frame[j].g, frame[j].b, want + j * 24);
+        }
+        if (!check(frame, want, base)) return false;
+    }
+    return true;
+}
+
+// first color in the frame whose 24 symbols differ
+static uint32_t first_bad_color(const char* got, const char* want, uint32_t base) {
+    for (int j = 0; j < LED_COUNT; j++)
+        if (std::memcmp(got + j * 24, want + j * 24, 24) != 0) return (base + j) % (1u << 24);
+    return base;
+}
+
+// ─── encoder ─────────────────────────────────────────────────────
+static bool encode_lut_all_colors() {
+    return for_all_colors([](const LEDArray& frame, const char* want, uint32_t base) {
+        char got[24];
+        for (int j = 0; j < LED_COUNT; j++) {
+            encode_color(frame[j], got);
+            if (std::memcmp(got, want + j * 24, 24) != 0) {
+                report_mismatch("encode_color", (base + j) % (1u << 24));
+                return false;
+            }
+        }
+        return true;
+    });
+}
+TEST(encode_lut_all_colors);
+
+static bool encode_leds_all_colors() {
+    return for_all_colors([](const LEDArray& frame, const char* want, uint32_t base) {
+        alignas(32) static char got[LED_FRAME_BYTES];
+        encode_leds(frame.data(), LED_COUNT, got);
+        if (std::memcmp(got, want, LED_FRAME_BYTES) == 0) return true;
+        report_mismatch("encode_leds", first_bad_color(got, want, base));
+        return false;
+    });
+}
+TEST(encode_leds_all_colors);
+
+// every kernel compiled into this build, fed a frame's GRB run (183 bytes,
+// so the vector loops leave a tail for the scalar fallback)
+static bool encode_kernels_all_colors() {
+    bool ok = true;
+    for (const char* name : { "scalar", "sse2", "avx2", "neon" }) {
+        encode_kernel_fn kernel = encode_kernel_by_name(name);
+        if (!kernel) {
+            printf("[led_test]   %-6s not available here\n", name);
+            continue;
+        }
+        bool kernel_ok = for_all_colors([&](const LEDArray& frame, const char* want, uint32_t base) {
+            alignas(32) uint8_t grb[LED_COUNT * 3];
+            alignas(32) static char got[LED_FRAME_BYTES];
+            for (int j = 0; j < LED_COUNT; j++) {
+                grb[j * 3]     = frame[j].g;
+                grb[j * 3 + 1] = frame[j].r;
+                grb[j * 3 + 2] = frame[j].b;
+            }
+            kernel(grb, sizeof(grb), got);
+            if (std::memcmp(got, want, LED_FRAME_BYTES) == 0) return true;
+            report_mismatch(name, first_bad_color(got, want, base));
+            return false;
+        });
+        printf("[led_test]   %-6s %s\n", name, kernel_ok ? "ok" : "FAILED");
+        ok &= kernel_ok;
+    }
+    return ok;
+}
+TEST(encode_kernels_all_colors);
+
+// whatever encode_frame() picked at startup, swizzle included
+static bool encode_frame_all_colors() {
+    printf("[led_test]   selected kernel: %s\n", encode_frame_kernel());
+    return for_all_colors([](const LEDArray& frame, const char* want, uint32_t base) {
+        alignas(32) static char got[LED_FRAME_BYTES];
+        encode_frame(frame, got);
+        if (std::memcmp(got, want, LED_FRAME_BYTES) == 0) return true;
+        report_mismatch("encode_frame", first_bad_color(got, want, base));
+        return false;
+    });
+}
+TEST(encode_frame_all_colors);
+
+// ─── output stage ────────────────────────────────────────────────
+// dithered output repeats every LED_DITHER_PERIOD frames (the tx cache
+// relies on that) and averages out to the 8.8 value to a quarter step
+static bool output_dither_cycle() {
+    LEDOutputStage output;
+    output.SetGamma(2.2f);
+    LEDArray in;
+    for (int i = 0; i < LED_COUNT; i++) in[i] = { static_cast<uint8_t>(i * 4), static_cast<uint8_t>(i), 200 };
+    std::vector<LEDArray> out(3 * LED_DITHER_PERIOD, in);
+    for (LEDArray& frame : out) output.Apply(frame);
+    for (size_t k = LED_DITHER_PERIOD; k < out.size(); k++) {
+        if (out[k] != out[k - LED_DITHER_PERIOD]) {
+            printf("[led_test] frame %zu differs from frame %zu\n", k, k - LED_DITHER_PERIOD);
+            return false;
+        }
+    }
+    output.SetDither(false);
+    LEDArray exact = in;
+    output.Apply(exact);   // rounded, same LUT
+    const uint8_t* rounded = &exact[0].r;
+    for (int i = 0; i < LED_COUNT * 3; i++) {
+        int sum = 0;
+        for (int k = 0; k < LED_DITHER_PERIOD; k++) sum += (&out[k][0].r)[i];
+        // the mean lands within half a step of the rounded value
+        if (std::abs(sum - rounded[i] * LED_DITHER_PERIOD) > LED_DITHER_PERIOD / 2) {
+            printf("[led_test] channel %d averages %.2f, rounds to %u\n", i, sum / double(LED_DITHER_PERIOD), rounded[i]);
+            return false;
+        }
+    }
+    return true;
+}
+TEST(output_dither_cycle);
+
+// ─── frame cache ─────────────────────────────────────────────────
+// largest per channel difference
+static int frame_distance(const LEDArray& a, const LEDArray& b) {
+    int worst = 0;
+    for (int i = 0; i < LED_COUNT * 3; i++) worst = std::max(worst, std::abs((&a[0].r)[i] - (&b[0].r)[i]));
+    return worst;
+}
+
+// played out of its table at 50 fps, which mostly falls between baked
+// frames, an animation stays within a few steps of rendering it live. the
+// cache is set up like the manager sets it with the tx cache on: a 90 deg/s
+// orb (32 table frames/s) has to blend, a 300 deg/s one (107/s) may snap
+// and then repeats exactly every turn.
+static bool baked_playback_tracks_live() {
+    const int tolerance = 4;           // blended
+    const int snapped_tolerance = 8;   // up to half a table frame off
+    for (float speed : {90.0f, 300.0f}) {
+        LEDFrameCache cache;
+        cache.SetExactFrames(50.0f);
+        CachedAnimation cached(std::make_shared<tfw::RotatingOrbAnimator>(HSV{240.0f, 1.0f, 1.0f}, led_color_t{10, 10, 20}, speed), cache);
+        tfw::RotatingOrbAnimator live(HSV{240.0f, 1.0f, 1.0f}, led_color_t{10, 10, 20}, speed);
+        const int cycle = static_cast<int>(360.0f / speed / 0.020f + 0.5f);
+        std::vector<LEDArray> out(3 * cycle);
+        LEDArray want;
+        render_time_t t{};
+        for (size_t k = 0; k < out.size(); k++, t += std::chrono::milliseconds(20)) {
+            cached.Render(t, out[k]);
+            live.Render(t, want);
+            if (frame_distance(out[k], want) > (speed == 300.0f ? snapped_tolerance : tolerance)) {
+                printf("[led_test] %.0f deg/s orb: frame %zu is %d off the live one\n", speed, k, frame_distance(out[k], want));
+                return false;
+            }
+        }
+        if (cache.ExactFrames(360.0f / speed) != (speed == 300.0f)) {
+            printf("[led_test] %.0f deg/s orb: exact frames %s\n", speed, speed == 300.0f ? "off" : "on");
+            return false;
+        }
+        if (speed == 300.0f && out[2 * cycle] != out[cycle]) {
+            printf("[led_test] snapped playback doesn't repeat every turn\n");
+            return false;
+        }
+    }
+    Glow glow(5, led_color_t{40, 120, 255}, led_color_t{5, 5, 10});
+    LEDFrameCache cache;
+    cache.SetExactFrames(50.0f);
+    CachedAnimation cached(std::make_shared<Glow>(5, led_color_t{40, 120, 255}, led_color_t{5, 5, 10}), cache);
+    LEDArray got, want;
+    render_time_t t{};
+    for (int k = 0; k < 300; k++, t += std::chrono::milliseconds(20)) {
+        cached.Render(t, got);
+        glow.Render(t, want);
+        if (frame_distance(got, want) > tolerance) {
+            printf("[led_test] glow: frame %d is %d off the live one\n", k, frame_distance(got, want));
+            return false;
+        }
+    }
+    return true;
+}
+TEST(baked_playback_tracks_live);
+
+// ─── pipeline ────────────────────────────────────────────────────
+static LEDArray test_frame(uint32_t seed) {
+    LEDArray frame;
+    for (int i = 0; i < LED_COUNT; i++) {
+        uint32_t v = (seed + i) * 2654435761u;
+        frame[i] = { static_cast<uint8_t>(v >> 8), static_cast<uint8_t>(v >> 16), static_cast<uint8_t>(v >> 24) };
+    }
+    return frame;
+}
+
+// false if the output thread didn't hand `count` frames to the sink within a second
+static bool wait_for_frames(const mem_sink_t& sink, size_t count) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (sink.FrameCount() < count) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    return true;
+}
+
+// manager on a mem sink with an identity output stage and no keep-alive, so
+// what comes out is what was rendered. tx cache off unless asked for.
+static bool start_on_mem_sink(tfw::LEDManager& mgr, mem_sink_t*& sink, size_t tx_cache_budget = 0) {
+    auto owned = std::make_unique<mem_sink_t>();
+    sink = owned.get();
+    if (!mgr.Initialize(std::move(owned))) {
+        printf("[led_test] Initialize failed\n");
+        return false;
+    }
+    for (int ring = 0; ring < 5; ring++) mgr.Output().SetRingGain(ring, 1.0f);
+    mgr.Output().SetGamma(1.0f);
+    mgr.Output().SetBrightness(1.0f);
+    mgr.Output().SetDither(false);
+    mgr.SetKeepAlive(std::chrono::milliseconds(0));
+    mgr.SetTxCacheBudget(tx_cache_budget);
+    return wait_for_frames(*sink, 1);   // the blank frame from Initialize()
+}
+
+// Renders one frame for t and returns what the strip got: the new frame, or
+// the last one if the output thread skipped it as unchanged.
+static bool render_through(tfw::LEDManager& mgr, const mem_sink_t& sink, Animatable& animation,
+                           render_time_t t, LEDArray& got) {
+    const uint64_t before = sink.FrameCount() + mgr.SkippedFrames();
+    mgr.RenderFrame(animation, t);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (sink.FrameCount() + mgr.SkippedFrames() == before) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            printf("[led_test] frame never reached the output thread\n");
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    got = sink.Frames().back();
+    return true;
+}
+
+// a long run keeps only the newest max_frames, the count still covers all
+static bool mem_sink_keeps_last_frames() {
+    mem_sink_t sink(true, 8);
+    std::vector<char> tx(LED_FRAME_BYTES);
+    for (uint32_t k = 0; k < 20; k++) {
+        encode_frame(test_frame(k), tx.data());
+        sink.transfer(tx.data(), static_cast<uint32_t>(tx.size()));
+    }
+    std::vector<LEDArray> got = sink.Frames();
+    if (sink.FrameCount() != 20 || got.size() != 8 || sink.RawBuffers().size() != 8) {
+        printf("[led_test] %zu frames counted, %zu kept, expected 20 and 8\n", sink.FrameCount(), got.size());
+        return false;
+    }
+    for (uint32_t k = 0; k < 8; k++) {
+        if (got[k] != test_frame(12 + k)) {
+            printf("[led_test] kept frame %u isn't frame %u\n", k, 12 + k);
+            return false;
+        }
+    }
+    return true;
+}
+TEST(mem_sink_keeps_last_frames);
+
+// puts out test_frame(seed) for whatever t it gets
+struct PatternAnimation : Animatable {
+    uint32_t seed = 0;
+    void Render(render_time_t, led_span_t out) override { out.copy_from(test_frame(seed)); }
+};
+
+
+// RenderFrame -> output stage -> encoder -> transport, decoded back out of
+// the sink. the output stage is set to identity so what comes out has to be
+// exactly what got published.
+static bool pipeline_mem_sink_roundtrip() {
+    const int frame_count = 16;
+    tfw::LEDManager mgr;
+    auto owned = std::make_unique<mem_sink_t>();
+    mem_sink_t& sink = *owned;
+    if (!mgr.Initialize(std::move(owned))) {
+        printf("[led_test] Initialize failed\n");
+        return false;
+    }
+    for (int ring = 0; ring < 5; ring++) mgr.Output().SetRingGain(ring, 1.0f);
+    mgr.Output().SetGamma(1.0f);
+    mgr.Output().SetBrightness(1.0f);
+    mgr.Output().SetDither(false);
+    mgr.SetKeepAlive(std::chrono::milliseconds(0));
+
+    // Initialize() publishes a blank frame first
+    if (!wait_for_frames(sink, 1)) {
+        printf("[led_test] blank frame never reached the sink\n");
+        return false;
+    }
+    PatternAnimation pattern;
+    std::vector<LEDArray> published;
+    for (int k = 0; k < frame_count; k++) {
+        pattern.seed = static_cast<uint32_t>(k * 7 + 1);
+        published.push_back(test_frame(pattern.seed));
+        mgr.RenderFrame(pattern);
+        if (!wait_for_frames(sink, published.size() + 1)) {
+            printf("[led_test] frame %d never reached the sink\n", k);
+            return false;
+        }
+    }
+
+    std::vector<LEDArray> got = sink.Frames();
+    bool ok = sink.DecodeErrors() == 0 && got.size() == published.size() + 1;
+    if (!ok) printf("[led_test] %zu frames decoded, %zu decode errors, expected %zu frames\n",
+                    got.size(), sink.DecodeErrors(), published.size() + 1);
+    for (size_t k = 0; ok && k < published.size(); k++) {
+        if (got[k + 1] != published[k]) {
+            printf("[led_test] decoded frame %zu differs from the published one\n", k);
+            ok = false;
+        }
+    }
+    return ok;
+}
+TEST(pipeline_mem_sink_roundtrip);
+
+// with the default output stage (dither on) a still frame goes out once, the
+// repeats count as skipped even though their dither phase moves
+static bool pipeline_skips_still_dithered_frames() {
+    tfw::LEDManager mgr;
+    auto owned = std::make_unique<mem_sink_t>();
+    mem_sink_t& sink = *owned;
+    if (!mgr.Initialize(std::move(owned))) {
+        printf("[led_test] Initialize failed\n");
+        return false;
+    }
+    mgr.SetKeepAlive(std::chrono::milliseconds(0));
+    mgr.SetTxCacheBudget(0);
+    PatternAnimation pattern;
+    pattern.seed = 3;
+    mgr.RenderFrame(pattern);
+    if (!wait_for_frames(sink, 2)) {
+        printf("[led_test] first frame never reached the sink\n");
+        return false;
+    }
+    for (int k = 0; k < 3 * LED_DITHER_PERIOD; k++) {
+        mgr.RenderFrame(pattern);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    // one frame later: a change still goes out
+    pattern.seed = 4;
+    mgr.RenderFrame(pattern);
+    bool arrived = wait_for_frames(sink, 3);
+    if (!arrived || sink.FrameCount() != 3 || mgr.SkippedFrames() == 0) {
+        printf("[led_test] %zu frames sent, %llu skipped, expected 3 sent and some skipped\n", sink.FrameCount(),
+               static_cast<unsigned long long>(mgr.SkippedFrames()));
+        return false;
+    }
+    return true;
+}
+TEST(pipeline_skips_still_dithered_frames);
+
+// LRU inside the table cache: a third set of params evicts the oldest table,
+// which then has to be baked again, the others are hits
+static bool frame_cache_lru() {
+    LEDFrameCache cache(2);
+    tfw::RotatingOrbAnimator red(HSV{0.0f, 1.0f, 1.0f}, led_color_t{0, 0, 0});
+    tfw::RotatingOrbAnimator green(HSV{120.0f, 1.0f, 1.0f}, led_color_t{0, 0, 0});
+    tfw::RotatingOrbAnimator blue(HSV{240.0f, 1.0f, 1.0f}, led_color_t{0, 0, 0});
+    render_time_t t{};
+    cache.Get(red, t);
+    cache.Get(green, t);
+    cache.Get(red, t);        // hit, green is the oldest now
+    cache.Get(blue, t);       // evicts green
+    cache.Get(red, t);        // hit
+    cache.Get(green, t);      // baked again, evicts blue
+    if (cache.Bakes() != 4 || cache.Hits() != 2 || cache.Evictions() != 2 || cache.Size() != 2) {
+        printf("[led_test] %llu bakes, %llu hits, %llu evictions, %zu tables; expected 4, 2, 2, 2\n",
+               static_cast<unsigned long long>(cache.Bakes()), static_cast<unsigned long long>(cache.Hits()),
+               static_cast<unsigned long long>(cache.Evictions()), cache.Size());
+        return false;
+    }
+    return true;
+}
+TEST(frame_cache_lru);
+
+// the same orb rendered live and out of its baked table, both through a
+// manager into a mem sink: the strip gets the same frames within a few
+// steps. halfway the colour changes, which changes ParamHash(), so the
+// cached one has to bake a new table rather than keep playing the old one.
+static bool frame_cache_pipeline_roundtrip() {
+    tfw::LEDManager live_mgr, cached_mgr;
+    mem_sink_t* live_sink = nullptr;
+    mem_sink_t* cached_sink = nullptr;
+    if (!start_on_mem_sink(live_mgr, live_sink) || !start_on_mem_sink(cached_mgr, cached_sink)) return false;
+
+    const HSV blue{240.0f, 1.0f, 1.0f}, orange{30.0f, 1.0f, 1.0f};
+    tfw::RotatingOrbAnimator live(blue, led_color_t{10, 10, 20}, 300.0f);
+    auto orb = std::make_shared<tfw::RotatingOrbAnimator>(blue, led_color_t{10, 10, 20}, 300.0f);
+    LEDFrameCache cache;
+    CachedAnimation cached(orb, cache);
+
+    LEDArray want, got;
+    render_time_t t{};
+    for (int k = 0; k < 120; k++, t += std::chrono::milliseconds(20)) {
+        if (k == 60) {
+            live.setOrbColor(orange);
+            orb->setOrbColor(orange);
+        }
+        if (!render_through(live_mgr, *live_sink, live, t, want)) return false;
+        if (!render_through(cached_mgr, *cached_sink, cached, t, got)) return false;
+        if (frame_distance(got, want) > 4) {
+            printf("[led_test] frame %d out of the cache is %d off the live one\n", k, frame_distance(got, want));
+            return false;
+        }
+    }
+    if (cache.Bakes() != 2) {
+        printf("[led_test] %llu bakes, expected one per colour\n", static_cast<unsigned long long>(cache.Bakes()));
+        return false;
+    }
+    return true;
+}
+TEST(frame_cache_pipeline_roundtrip);
+
+// one set, so every frame competes for the same 4 ways: the least recently
+// used one goes, a hit hands back the buffer still holding its frame, and
+// a new output generation flushes everything
+static bool tx_cache_lru() {
+    const uint32_t tx_len = LED_FRAME_BYTES + 64;
+    LEDTxCache cache;
+    if (!cache.Configure(tx_len, (tx_len + 63) / 64 * 64 * LED_TX_CACHE_WAYS)) {
+        printf("[led_test] Configure failed\n");
+        return false;
+    }
+    std::vector<char> want(LED_FRAME_BYTES);
+    bool hit = false;
+    auto get = [&](uint32_t seed, uint32_t generation) {
+        char* tx = cache.Get(test_frame(seed), generation, hit);
+        if (!hit) encode_frame(test_frame(seed), tx);
+        return tx;
+    };
+    for (uint32_t seed = 0; seed < 4; seed++) get(seed, 1);
+    get(0, 1);                         // hit, 1 is the oldest now
+    bool hit0 = hit;
+    get(4, 1);                         // evicts 1
+    get(1, 1);                         // miss, evicts 2
+    bool hit1 = hit;
+    char* tx = get(3, 1);              // hit
+    bool hit3 = hit;
+    encode_frame(test_frame(3), want.data());
+    if (!hit0 || hit1 || !hit3 || std::memcmp(tx, want.data(), LED_FRAME_BYTES) != 0) {
+        printf("[led_test] LRU order broken (hits %d %d %d) or a hit buffer lost its frame\n", hit0, hit1, hit3);
+        return false;
+    }
+    get(3, 2);
+    if (hit || cache.Flushes() == 0) {
+        printf("[led_test] a new generation didn't flush the cache\n");
+        return false;
+    }
+    if (cache.Hits() != 2 || cache.Misses() != 7) {
+        printf("[led_test] %llu hits, %llu misses, expected 2 and 7\n", static_cast<unsigned long long>(cache.Hits()),
+               static_cast<unsigned long long>(cache.Misses()));
+        return false;
+    }
+    return true;
+}
+TEST(tx_cache_lru);
+
+// a looping pattern, dithered, through two managers on mem sinks, one with
+// the tx cache on: once the cycle comes round the cached one sends
+// straight from the cache, and the strip gets exactly the same frames
+static bool tx_cache_pipeline_roundtrip() {
+    tfw::LEDManager plain_mgr, cached_mgr;
+    mem_sink_t* plain_sink = nullptr;
+    mem_sink_t* cached_sink = nullptr;
+    if (!start_on_mem_sink(plain_mgr, plain_sink) ||
+        !start_on_mem_sink(cached_mgr, cached_sink, LED_TX_CACHE_DEFAULT_BUDGET)) return false;
+    plain_mgr.Output().SetDither(true);
+    cached_mgr.Output().SetDither(true);
+    plain_mgr.Output().SetGamma(2.2f);
+    cached_mgr.Output().SetGamma(2.2f);
+
+    PatternAnimation pattern;
+    LEDArray want, got;
+    render_time_t t{};
+    for (int k = 0; k < 8 * 6; k++, t += std::chrono::milliseconds(20)) {
+        pattern.seed = static_cast<uint32_t>(k % 6);
+        if (!render_through(plain_mgr, *plain_sink, pattern, t, want)) return false;
+        if (!render_through(cached_mgr, *cached_sink, pattern, t, got)) return false;
+        if (got != want) {
+            printf("[led_test] frame %d out of the tx cache differs from the encoded one\n", k);
+            return false;
+        }
+    }
+    // 6 frames times 4 dither phases come round every 12 frames
+    if (cached_mgr.Stats().cached == 0 || cached_sink->DecodeErrors() != 0) {
+        printf("[led_test] %llu frames sent from the cache, %zu decode errors\n",
+               static_cast<unsigned long long>(cached_mgr.Stats().cached), cached_sink->DecodeErrors());
+        return false;
+    }
+    return true;
+}
+TEST(tx_cache_pipeline_roundtrip);
+
+// a Show() from another thread while PlayAnimation() runs must not start the
+// render thread next to it, only once PlayAnimation() returns
+struct FlagAnimation : Animatable {
+    std::atomic<int> renders{0};
+    void Render(render_time_t, led_span_t out) override {
+        renders.fetch_add(1);
+        out.fill({0, 0, 0});
+    }
+};
+
+struct ShowFromThreadAnimation : Animatable {
+    tfw::LEDManager* mgr = nullptr;
+    std::shared_ptr<FlagAnimation> shown;
+    int frame = 0;
+    bool overlapped = false;
+    void Render(render_time_t, led_span_t out) override {
+        if (frame++ == 1) {
+            std::thread([this] { mgr->Show(shown); }).join();
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        if (shown->renders.load() > 0) overlapped = true;
+        out.fill({0, 0, 0});
+    }
+};
+
+static bool play_blocks_show() {
+    tfw::LEDManager mgr;
+    if (!mgr.Initialize(std::make_unique<mem_sink_t>())) {
+        printf("[led_test] Initialize failed\n");
+        return false;
+    }
+    // frames back to back, one second of clock time is 50 of them
+    mgr.SetClock(std::make_shared<ManualClock>(render_time_t{}, std::chrono::milliseconds(20)));
+    ShowFromThreadAnimation playing;
+    playing.mgr = &mgr;
+    playing.shown = std::make_shared<FlagAnimation>();
+    mgr.PlayAnimation(playing, 1);
+    if (playing.overlapped) {
+        printf("[led_test] Show() rendered while PlayAnimation() was running\n");
+        return false;
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (playing.shown->renders.load() == 0) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            printf("[led_test] the held back Show() never started the render thread\n");
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    mgr.StopRendering();
+    return true;
+}
+TEST(play_blocks_show);
+
+// ─── gif ─────────────────────────────────────────────────────────
+// textbook gif LZW decoder, strict about code widths: false if the stream
+// ends before EOI, a code is out of range or bytes follow the terminator
+static bool reference_gif_decode(const std::vector<uint8_t>& in, std::vector<uint8_t>& out) {
+    if (in.empty() || in[0] != 8) return false;
+    std::vector<uint8_t> data;
+    size_t pos = 1;
+    while (pos < in.size() && in[pos] != 0) {
+        size_t n = in[pos++];
+        if (pos + n > in.size()) return false;
+        data.insert(data.end(), in.begin() + pos, in.begin() + pos + n);
+        pos += n;
+    }
+    if (pos + 1 != in.size()) return false;
+
+    const uint32_t clear_code = 256, eoi_code = 257;
+    std::vector<std::vector<uint8_t>> table(4096);
+    for (uint32_t c = 0; c < 256; c++) table[c] = { static_cast<uint8_t>(c) };
+    size_t bit = 0;
+    int code_size = 9;
+    uint32_t next = 258;
+    int64_t prev = -1;
+    while (true) {
+        if (bit + code_size > data.size() * 8) return false;   // ran out before EOI
+        uint32_t code = 0;
+        for (int k = 0; k < code_size; k++, bit++)
+            code |= ((data[bit / 8] >> (bit % 8)) & 1u) << k;
+        if (code == clear_code) {
+            code_size = 9;
+            next = 258;
+            prev = -1;
+            continue;
+        }
+        if (code == eoi_code) return true;
+        if (prev < 0) {
+            if (code >= 256) return false;
+        } else {
+            if (code > next) return false;
+            std::vector<uint8_t> entry = table[prev];
+            entry.push_back(code < next ? table[code][0] : table[prev][0]);
+            if (next < 4096) {
+                table[next++] = std::move(entry);
+                if (next == (1u << code_size) && code_size < 12) code_size++;
+            }
+        }
+        if (code >= next) return false;
+        out.insert(out.end(), table[code].begin(), table[code].end());
+        prev = code;
+    }
+}
+
+// every length up to a few thousand indices walks the pending entry across
+// each width boundary, the long ones also go through table resets
+static bool gif_lzw_roundtrip() {
+    std::vector<size_t> lengths;
+    for (size_t n = 1; n <= 4096; n++) lengths.push_back(n);
+    for (int side : {64, 96, 128, 256}) lengths.push_back(static_cast<size_t>(side) * side);
+    for (int colors : {2, LED_COUNT + 1, 256}) {
+        for (size_t n : lengths) {
+            std::vector<uint8_t> indices(n);
+            uint32_t v = static_cast<uint32_t>(colors);
+            for (size_t i = 0; i < n; i++) {
+                v = v * 1664525u + 1013904223u;
+                indices[i] = static_cast<uint8_t>((v >> 16) % colors);
+            }
+            std::vector<uint8_t> stream, decoded;
+            gif_lzw(indices, stream);
+            if (!reference_gif_decode(stream, decoded) || decoded != indices) {
+                printf("[led_test] %zu indices over %d colours don't decode back\n", n, colors);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+TEST(gif_lzw_roundtrip);
+
+int main(int argc, char** argv) {
+    const char* filter = argc > 1 ? argv[1] : nullptr;
+    int failed = 0, run = 0;
+    for (const auto& test : registry()) {
+        if (filter && !std::strstr(test.name, filter)) continue;
+        printf("[led_test] %s\n", test.name);
+        bool ok = test.fn();
+        printf("[led_test] %s %s\n", ok ? "PASS" : "FAIL", test.name);
+        failed += !ok;
+        ++run;
+    }
+    printf("[led_test] %d/%d passed\n", run - failed, run);
+    return failed ? 1 : 0;
+}
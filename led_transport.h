@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/mman.h>
+
+/*
+whatever sits at the end of the output thread: the real spidev (spi.h)
+or one of the sinks in led_sinks.h for running without the board.
+owns the transmit ring so every backend gets the same buffers.
+*/
+
+//transmit ring: page aligned + mlock'd so the hot path never faults or memsets
+#define TX_RING_SIZE 3
+
+struct led_transport_t {
+    char* tx_mem = nullptr;
+    size_t tx_stride = 0;
+    size_t tx_map_len = 0;
+    uint32_t tx_len = 0;
+    uint32_t tx_head = 0;
+    bool tx_locked = false;
+
+    virtual ~led_transport_t(){
+        free_tx_ring();
+    }
+
+    virtual bool ok() const = 0;
+    virtual const char* name() const = 0;
+    //sends one complete buffer (payload + tail), blocking until it's out
+    virtual bool transfer(char* tx_buffer, uint32_t len) = 0;
+
+    //allocates the tx ring, each buffer is `payload` bytes followed by `tail` zero bytes
+    //the tail is zeroed once here and never written again
+    bool setup_tx_ring(uint32_t payload, uint32_t tail){
+        free_tx_ring();
+        long page = sysconf(_SC_PAGESIZE);
+        if(page <= 0) page = 4096;
+        tx_len = payload + tail;
+        tx_stride = (tx_len + page - 1) / page * page;
+        tx_map_len = tx_stride * TX_RING_SIZE;
+        void* mem = mmap(nullptr, tx_map_len, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+        if(mem == MAP_FAILED){
+            printf("[%s] Error: failed to map tx ring (%zu bytes) \n", name(), tx_map_len);
+            tx_map_len = 0; tx_len = 0;
+            return false;
+        }
+        tx_mem = static_cast<char*>(mem); //anonymous pages come back zeroed, tails included
+        tx_locked = mlock(tx_mem, tx_map_len) == 0;
+        if(!tx_locked) printf("[%s] Warning: mlock of tx ring failed (%s), continuing unlocked \n", name(), std::strerror(errno));
+        tx_head = 0;
+        return true;
+    }
+    //next buffer in the ring, write the payload then hand it to transfer(buf, tx_len)
+    char* next_tx(){
+        char* buf = tx_mem + tx_stride * tx_head;
+        tx_head = (tx_head + 1) % TX_RING_SIZE;
+        return buf;
+    }
+    void free_tx_ring(){
+        if(!tx_mem) return;
+        if(tx_locked) munlock(tx_mem, tx_map_len);
+        munmap(tx_mem, tx_map_len);
+        tx_mem = nullptr; tx_locked = false; tx_map_len = 0; tx_len = 0;
+    }
+};
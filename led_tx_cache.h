@@ -0,0 +1,154 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "led_color.h"
+
+/*
+encoded frame cache on the output thread: complete transmit buffers
+(WS2812B symbols + reset tail) keyed by the final frame they encode.
+a looping animation only ever puts out a few hundred distinct frames (a
+baked cycle times the 4 dither phases at most), so after the first cycle
+every frame is a hash, a 183 byte compare and a transfer straight out of
+the cache, the encoder never runs.
+the key is the calibrated frame itself (verified byte for byte, not just
+the hash), so a stale buffer can't be sent. entries still get flushed
+when the output stage's generation moves, after a gamma / gain /
+brightness change none of them would match again anyway.
+4-way set associative, LRU inside a set, so the hot path never allocates
+or walks the whole cache. the arena is mmap'd + mlock'd like the tx ring.
+*/
+
+#define LED_TX_CACHE_WAYS 4
+#define LED_TX_CACHE_DEFAULT_BUDGET (1024 * 1024)  // ~650 frames of 61 leds, a dithered baked cycle fits
+
+// 64 bit hash over the frame bytes, only needs to spread the sets. four
+// independent lanes so it isn't one long multiply chain, ~15 ns
+inline uint64_t led_frame_hash(const LEDArray& frame) {
+    const uint8_t* p = &frame[0].r;
+    size_t n = sizeof(LEDArray);
+    uint64_t lane[4] = {0x9e3779b97f4a7c15ull, 0xbf58476d1ce4e5b9ull, 0x94d049bb133111ebull, n};
+    for (; n >= 32; n -= 32, p += 32) {
+        for (int i = 0; i < 4; ++i) {
+            uint64_t w;
+            std::memcpy(&w, p + i * 8, 8);
+            lane[i] = (lane[i] ^ w) * 0xff51afd7ed558ccdull;
+        }
+    }
+    uint64_t tail[4] = {};
+    std::memcpy(tail, p, n);
+    uint64_t h = 0;
+    for (int i = 0; i < 4; ++i) {
+        uint64_t v = (lane[i] ^ tail[i]) * 0xc4ceb9fe1a85ec53ull;
+        h = (h ^ (v >> 29) ^ v) * 0xff51afd7ed558ccdull;
+    }
+    return h ^ (h >> 32);
+}
+
+class LEDTxCache {
+public:
+    LEDTxCache() = default;
+    LEDTxCache(const LEDTxCache&) = delete;
+    LEDTxCache& operator=(const LEDTxCache&) = delete;
+    ~LEDTxCache() { Release(); }
+
+    // Sizes the cache for buffers of `tx_len` bytes (payload first, zero tail
+    // after it) within `budget` bytes. False if the budget doesn't hold a set.
+    bool Configure(uint32_t tx_len, size_t budget) {
+        Release();
+        stride = (tx_len + 63) / 64 * 64;
+        sets = budget / (stride * LED_TX_CACHE_WAYS);
+        if (sets == 0) return false;
+        map_len = sets * LED_TX_CACHE_WAYS * stride;
+        void* mem = mmap(nullptr, map_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+        if (mem == MAP_FAILED) {
+            printf("[LEDTxCache] Error: failed to map %zu bytes \n", map_len);
+            sets = 0; map_len = 0;
+            return false;
+        }
+        arena = static_cast<char*>(mem);   // zeroed, so are the tails
+        locked = mlock(arena, map_len) == 0;
+        tags = new tag_t[sets * LED_TX_CACHE_WAYS]();
+        frames = new LEDArray[sets * LED_TX_CACHE_WAYS];
+        this->tx_len = tx_len;
+        printf("[LEDTxCache] %zu frames in %zu KB%s \n", sets * LED_TX_CACHE_WAYS, map_len / 1024,
+               locked ? "" : " (not mlock'd)");
+        return true;
+    }
+    void Release() {
+        if (arena) {
+            if (locked) munlock(arena, map_len);
+            munmap(arena, map_len);
+        }
+        delete[] tags;
+        delete[] frames;
+        arena = nullptr; tags = nullptr; frames = nullptr;
+        sets = 0; map_len = 0; locked = false;
+    }
+    bool Enabled() const { return arena != nullptr; }
+
+    // Buffer for `frame`. hit: it already holds the encoded frame, send it as
+    // is. Otherwise the least recently used way of its set got reassigned,
+    // encode the payload into it. `generation` is the output stage's.
+    char* Get(const LEDArray& frame, uint32_t generation, bool& hit) {
+        if (generation != built) {
+            Flush();
+            built = generation;
+        }
+        const uint64_t h = led_frame_hash(frame);
+        const size_t set = static_cast<size_t>(((h >> 32) * sets) >> 32) * LED_TX_CACHE_WAYS;   // no divide
+        size_t victim = set;
+        ++use_clock;
+        for (size_t i = set; i < set + LED_TX_CACHE_WAYS; ++i) {
+            tag_t& tag = tags[i];
+            if (tag.used && tag.hash == h && std::memcmp(frames[i].data(), frame.data(), sizeof(LEDArray)) == 0) {
+                tag.used = use_clock;
+                ++hits;
+                hit = true;
+                return arena + i * stride;
+            }
+            if (tag.used < tags[victim].used) victim = i;
+        }
+        tags[victim] = tag_t{h, use_clock};
+        frames[victim] = frame;
+        ++misses;
+        hit = false;
+        return arena + victim * stride;
+    }
+
+    void Flush() {
+        for (size_t i = 0; i < sets * LED_TX_CACHE_WAYS; ++i) tags[i].used = 0;
+        ++flushes;
+    }
+
+    uint32_t TxLen() const { return tx_len; }
+    size_t Bytes() const { return map_len; }
+    uint64_t Hits() const { return hits; }
+    uint64_t Misses() const { return misses; }
+    uint64_t Flushes() const { return flushes; }
+
+private:
+    // a set's tags share one cache line, the frames are only touched on a tag match
+    struct tag_t {
+        uint64_t hash;
+        uint64_t used;     // last use, 0 = empty
+    };
+
+    char* arena = nullptr;
+    tag_t* tags = nullptr;
+    LEDArray* frames = nullptr;
+    size_t stride = 0;
+    size_t sets = 0;
+    size_t map_len = 0;
+    uint32_t tx_len = 0;
+    bool locked = false;
+    uint32_t built = 0;
+    uint64_t use_clock = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t flushes = 0;
+};
@@ -2,7 +2,10 @@
 #include "spi.h"
 #include "led_color.h"
 #include "led_matrix.h"
-#include "rotating_orb_anim.h" // Included for friend class access
+#include "led_compositor.h"
+#include "led_frame_cache.h"
+#include "led_tx_cache.h"
+#include "led_encode.h"
 
 #include <vector>
 #include <array>
@@ -10,42 +13,68 @@
 #include <chrono>
 #include <thread>
 #include <unistd.h>
+#include <cstring>
 
 
-static_assert(LED_COUNT * 24 < SPI_BUFFER_SIZE );
+static_assert(LED_FRAME_BYTES + WS2812B_RESET_BYTES < SPI_BUFFER_SIZE );
 
 namespace tfw {
 
-LEDManager::LEDManager() : functional(false) {
+std::atomic<bool> LEDManager::stats_dump_requested{false};
+
+LEDManager::LEDManager()
+    : functional(false), tx_cache(std::make_unique<LEDTxCache>()), tx_cache_budget(LED_TX_CACHE_DEFAULT_BUDGET),
+      frame_cache(std::make_unique<LEDFrameCache>()) {
     // Constructor is now much simpler.
 }
 
 LEDManager::~LEDManager() {
     if (functional) {
         Clear();
+        // output thread drains the final (blank) frame before exiting
+        {
+            std::lock_guard<std::mutex> lock(output_mutex);
+            output_running = false;
+        }
+        output_cv.notify_one();
+        output_thread.join();
     }
     std::cout << "[LEDManager] Shutting down." << std::endl;
 }
 
 bool LEDManager::Initialize() {
+    return Initialize(std::make_unique<spi_t>(WS2812B_SPI_SPEED));
+}
+
+bool LEDManager::Initialize(std::unique_ptr<led_transport_t> transport) {
+    if (functional) return true;
     std::cout << "[LEDManager] Initializing..." << std::endl;
-    spi = std::make_unique<spi_t>(WS2812B_SPI_SPEED);
-    if (spi->state != SPI_OPEN) {
-        std::cerr << "[LEDManager] Error: Failed to initialize SPI." << std::endl;
+    this->transport = std::move(transport);
+    if (!this->transport || !this->transport->ok()) {
+        std::cerr << "[LEDManager] Error: Failed to initialize output transport." << std::endl;
+        functional = false;
+        return false;
+    }
+    if (!this->transport->setup_tx_ring(LED_FRAME_BYTES, WS2812B_RESET_BYTES)) {
+        std::cerr << "[LEDManager] Error: Failed to allocate transmit buffers." << std::endl;
         functional = false;
         return false;
     }
     
-    matrix = std::make_unique<LEDMatrix>();
+    output_running = true;
+    output_thread = std::thread(&LEDManager::output_loop, this);
     functional = true;
     Clear();
-    std::cout << "[LEDManager] Initialization successful." << std::endl;
+    std::cout << "[LEDManager] Initialization successful (" << this->transport->name()
+              << ", encoder: " << encode_frame_kernel() << ")." << std::endl;
     return true;
 }
 
 void LEDManager::Clear() {
     if (!functional) return;
-    matrix->Clear(leds);
+    // the back frame belongs to the render thread while it runs
+    StopRendering();
+    back_frame().fill({0, 0, 0});
     update_leds();
 }
 
@@ -54,55 +83,369 @@ void LEDManager::PlayAnimation(Animatable& animation, int duration_seconds) {
         std::cerr << "[LEDManager] Error: Cannot play animation, not initialized." << std::endl;
         return;
     }
+    if (!begin_blocking("PlayAnimation", true)) return;
+    StopRendering();
 
-    auto start_time = std::chrono::steady_clock::now();
+    render_time_t start_time = clock->Now();
     auto duration = std::chrono::seconds(duration_seconds);
 
-    while (std::chrono::steady_clock::now() - start_time < duration) {
-        matrix->Clear(leds);
-        
-        animation.Update();
-        animation.Draw(matrix.get());
-        
-        matrix->Update(leds);
-        update_leds();
-        
-        // Sleep for ~20ms to achieve a smooth ~50 FPS
-        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    uint64_t missed_before = frame_clock.MissedDeadlines();
+    last_publish_ns = 0; // don't count the gap since the last animation as a frame interval
+    frame_clock.Reset();
+    for (render_time_t t = start_time; t - start_time < duration; t = clock->Now()) {
+        render_frame(animation, t);
+        clock->FrameDone();
+        if (clock->Paced()) frame_clock.Wait();
+        maybe_dump_stats();
+    }
+    report_missed(missed_before);
+    end_blocking();
+}
+
+void LEDManager::RenderFrame(Animatable& animation, render_time_t t) {
+    if (!functional) return;
+    // refused while the render thread runs, unlike PlayAnimation() it doesn't
+    // stop it: a stray call shouldn't cut whatever Show() put up
+    if (!begin_blocking("RenderFrame", false)) return;
+    render_frame(animation, t);
+    end_blocking();
+}
+
+bool LEDManager::begin_blocking(const char* who, bool render_thread_ok) {
+    // Show() from now on only parks its request, it can't start the render
+    // thread under us
+    std::lock_guard<std::mutex> lock(show_mutex);
+    if (blocking_playback) {
+        std::cerr << "[LEDManager] Error: " << who << " while PlayAnimation/RenderFrame runs on another thread." << std::endl;
+        return false;
+    }
+    if (!render_thread_ok && render_running.load(std::memory_order_relaxed)) {
+        std::cerr << "[LEDManager] Error: " << who << " while the render thread is running." << std::endl;
+        return false;
+    }
+    blocking_playback = true;
+    return true;
+}
+
+void LEDManager::end_blocking() {
+    // a Show() that came in meanwhile takes over from here
+    std::lock_guard<std::mutex> lock(show_mutex);
+    blocking_playback = false;
+    if (show_pending && !render_running.exchange(true)) {
+        render_thread = std::thread(&LEDManager::render_loop, this);
+    }
+}
+
+void LEDManager::render_frame(Animatable& animation, render_time_t t) {
+    StageTimer render(stage(FrameStage::Render));
+    {
+        StageTimer animate(stage(FrameStage::Animate));
+        animation.Render(t, back_frame());
+    }
+    update_leds();
+}
+
+void LEDManager::Show(std::shared_ptr<Animatable> animation, std::chrono::milliseconds fade, EaseCurve curve) {
+    frame_source_fn source;
+    if (animation) {
+        if (frame_cache_enabled.load(std::memory_order_relaxed))
+            animation = std::make_shared<CachedAnimation>(std::move(animation), *frame_cache);
+        source = [animation](render_time_t t, led_span_t out) { animation->Render(t, out); };
     }
+    post_show(std::move(source), fade, curve);
 }
 
-void LEDManager::PlayAnimation(RotatingOrbAnimator& animation, int duration_seconds) {
+void LEDManager::post_show(frame_source_fn source, std::chrono::milliseconds fade, EaseCurve curve) {
     if (!functional) {
-        std::cerr << "[LEDManager] Error: Cannot play animation, not initialized." << std::endl;
+        std::cerr << "[LEDManager] Error: Cannot show animation, not initialized." << std::endl;
         return;
     }
+    show_request_t dropped;
+    {
+        std::lock_guard<std::mutex> lock(show_mutex);
+        // a request the render thread hasn't picked up yet just gets replaced
+        if (show_pending) dropped = std::move(show_request);
+        show_request.source = std::move(source);
+        show_request.fade_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(fade).count();
+        show_request.curve = curve;
+        show_pending = true;
+        if (show_request.fade_ns > 0) in_transition.store(true, std::memory_order_relaxed);
+        if (!blocking_playback && !render_running.exchange(true)) {
+            render_thread = std::thread(&LEDManager::render_loop, this);
+        }
+    }
+    RequestFrame();
+}
 
-    auto start_time = std::chrono::steady_clock::now();
-    auto duration = std::chrono::seconds(duration_seconds);
+void LEDManager::SetOverlay(frame_source_fn source, BlendMode mode, float opacity) {
+    std::unique_ptr<LEDCompositor> comp;
+    if (source) {
+        comp = std::make_unique<LEDCompositor>();
+        comp->AddLayer([this](render_time_t, led_span_t out) { out.copy_from(overlay_base); }, BlendMode::Add);
+        comp->AddLayer(std::move(source), mode, opacity);
+    }
+    {
+        std::lock_guard<std::mutex> lock(show_mutex);
+        // swapped so whatever was pending gets freed outside the lock
+        std::swap(overlay_request, comp);
+        overlay_pending = true;
+    }
+    RequestFrame();
+}
 
-    while (std::chrono::steady_clock::now() - start_time < duration) {
-        // RotatingOrbAnimator uses a different interface - it returns the sleep time
-        uint64_t sleep_micros = animation(this);
-        
-        // Convert microseconds to milliseconds and sleep
-        if (sleep_micros > 0) {
-            std::this_thread::sleep_for(std::chrono::microseconds(sleep_micros));
+void LEDManager::StopRendering() {
+    std::thread stopping;
+    {
+        std::lock_guard<std::mutex> lock(show_mutex);
+        if (!render_running.exchange(false)) return;
+        stopping = std::move(render_thread);
+    }
+    RequestFrame();
+    stopping.join();
+}
+
+void LEDManager::render_loop() {
+    uint64_t missed_before = frame_clock.MissedDeadlines();
+    last_publish_ns = 0;
+    frame_clock.Reset();
+    while (render_running.load(std::memory_order_acquire)) {
+        {
+            StageTimer render(stage(FrameStage::Render));
+            int64_t now = clock->NowNs();
+            if (frame_hook) frame_hook(now);
+            show_request_t request;
+            bool have_request = false;
+            std::unique_ptr<LEDCompositor> old_overlay;
+            {
+                std::lock_guard<std::mutex> lock(show_mutex);
+                if (show_pending) {
+                    request = std::move(show_request);
+                    show_pending = false;
+                    have_request = true;
+                }
+                if (overlay_pending) {
+                    old_overlay = std::move(overlay);
+                    overlay = std::move(overlay_request);
+                    overlay_pending = false;
+                }
+            }
+            if (have_request) {
+                if (request.fade_ns <= 0) {
+                    fade_ns = 0;
+                    fade_source = nullptr;
+                    fade_frozen = false;
+                } else {
+                    if (fade_ns > 0) {
+                        // interrupted mid-fade, continue from exactly what's showing
+                        fade_from = last_rendered;
+                        fade_source = nullptr;
+                        fade_frozen = true;
+                    } else {
+                        fade_source = std::move(current_source);
+                        fade_frozen = false;
+                    }
+                    fade_start_ns = now;
+                    fade_ns = request.fade_ns;
+                    fade_curve = request.curve;
+                }
+                current_source = std::move(request.source);
+                in_transition.store(fade_ns > 0, std::memory_order_relaxed);
+            }
+            {
+                StageTimer animate(stage(FrameStage::Animate));
+                render_time_t t = render_time_from_ns(now);
+                // baked animations play exact table frames when those can come out of the tx
+                // cache, as long as the table has a frame for every output frame
+                frame_cache->SetExactFrames(tx_cache_budget.load(std::memory_order_relaxed) > 0
+                                            ? static_cast<float>(frame_clock.Fps()) : 0.0f);
+                render_transition(back_frame(), t);
+                if (overlay) {
+                    overlay_base = back_frame();
+                    overlay->Composite(t, back_frame());
+                }
+            }
+            update_leds();
         }
+        clock->FrameDone();
+        if (clock->Paced()) frame_clock.WaitOrWake(render_wake);
+        maybe_dump_stats();
+    }
+    report_missed(missed_before);
+}
+
+void LEDManager::render_transition(LEDArray& out, render_time_t t) {
+    const int64_t now = render_time_ns(t);
+    auto render = [t](frame_source_fn& source, LEDArray& frame) {
+        if (source) source(t, frame);
+        else frame.fill({0, 0, 0});
+    };
+    render(current_source, out);
+    if (fade_ns > 0) {
+        float t = static_cast<float>(now - fade_start_ns) / static_cast<float>(fade_ns);
+        if (t >= 1.0f) {
+            fade_ns = 0;
+            fade_source = nullptr;
+            fade_frozen = false;
+            in_transition.store(false, std::memory_order_relaxed);
+        } else {
+            if (!fade_frozen) render(fade_source, fade_from);
+            mix_frames(fade_from, out, ease(fade_curve, t), out);
+        }
+    }
+    last_rendered = out;
+}
+
+void LEDManager::report_missed(uint64_t missed_before) {
+    uint64_t total = frame_clock.MissedDeadlines();
+    uint64_t missed = total > missed_before ? total - missed_before : 0; // ResetStats() may have run
+    if (missed > 0) {
+        std::cerr << "[LEDManager] Missed " << missed << " frame deadline(s) at "
+                  << frame_clock.Fps() << " FPS (" << frame_clock.MissedDeadlines() << " total)." << std::endl;
     }
 }
 
+FrameStatsSnapshot LEDManager::Stats() const {
+    FrameStatsSnapshot snap;
+    for (int i = 0; i < static_cast<int>(FrameStage::Count); i++) {
+        snap.stages[i] = stage_hist[i].Summarize();
+    }
+    snap.frames = frames_published.load(std::memory_order_relaxed);
+    snap.transmitted = frames_transmitted.load(std::memory_order_relaxed);
+    snap.skipped = skipped_frames.load(std::memory_order_relaxed);
+    snap.cached = tx_cache_hits.load(std::memory_order_relaxed);
+    snap.missed_deadlines = frame_clock.MissedDeadlines();
+    snap.target_fps = frame_clock.Fps();
+    const auto& interval = snap[FrameStage::Interval];
+    snap.actual_fps = interval.mean_ns ? 1e9 / static_cast<double>(interval.mean_ns) : 0.0;
+    return snap;
+}
+
+void LEDManager::ResetStats() {
+    for (auto& h : stage_hist) h.Reset();
+    frames_published.store(0);
+    frames_transmitted.store(0);
+    skipped_frames.store(0);
+    tx_cache_hits.store(0);
+    frame_clock.ResetCounters();
+}
+
+void LEDManager::maybe_dump_stats() {
+    bool dump = stats_dump_requested.exchange(false, std::memory_order_relaxed);
+    int64_t interval_s = stats_dump_interval_s.load(std::memory_order_relaxed);
+    int64_t now = FrameClock::now_ns();
+    if (interval_s > 0 && now - last_stats_dump_ns >= interval_s * 1000000000ll) dump = true;
+    if (!dump) return;
+    last_stats_dump_ns = now;
+    Stats().Print(stdout);
+}
+
 void LEDManager::update_leds() {
     if (!functional) return;
-    char tx[LED_COUNT * 24] = {0};
-    for (int j = 0; j < LED_COUNT; j++) {
-        encode_color(this->leds[j], &tx[j * 24]);
+    {
+        StageTimer t(stage(FrameStage::Output));
+        frame_inputs[back_idx] = back_frame();
+        frame_gens[back_idx] = output.Generation();
+        output.Apply(back_frame());
     }
-    if (!spi->transfer(tx, sizeof(tx))) {
-        std::cerr << "[LEDManager] SPI transfer failed." << std::endl;
+    int64_t now = FrameClock::now_ns();
+    if (last_publish_ns != 0) {
+        int64_t interval = now - last_publish_ns;
+        int64_t jitter = interval - frame_clock.PeriodNs();
+        if (LatencyHistogram* h = stage(FrameStage::Interval)) h->Record(static_cast<uint64_t>(interval));
+        if (LatencyHistogram* h = stage(FrameStage::Jitter)) h->Record(static_cast<uint64_t>(jitter < 0 ? -jitter : jitter));
     }
-    usleep(5);
+    last_publish_ns = now;
+    frames_published.fetch_add(1, std::memory_order_relaxed);
+    back_idx = pending.exchange(back_idx | FRAME_FRESH) & FRAME_SLOT_MASK;
+    {
+        std::lock_guard<std::mutex> lock(output_mutex);
+    }
+    output_cv.notify_one();
 }
 
-} // namespace tfw
+void LEDManager::output_loop() {
+    std::unique_lock<std::mutex> lock(output_mutex);
+    while (true) {
+        auto fresh_or_stopped = [this] {
+            return !output_running || (pending.load() & FRAME_FRESH);
+        };
+        int64_t keep_alive = keep_alive_ms.load();
+        bool woke;
+        if (have_last_sent && keep_alive > 0) {
+            auto deadline = std::chrono::steady_clock::time_point(std::chrono::nanoseconds(last_sent_ns))
+                          + std::chrono::milliseconds(keep_alive);
+            woke = output_cv.wait_until(lock, deadline, fresh_or_stopped);
+        } else {
+            output_cv.wait(lock, fresh_or_stopped);
+            woke = true;
+        }
+
+        if (!woke) {
+            // nothing new for a whole keep-alive interval, refresh the strip anyway
+            lock.unlock();
+            transmit(last_sent);
+            lock.lock();
+            continue;
+        }
+        if (!(pending.load() & FRAME_FRESH)) break; // stopped and nothing left to send
+        lock.unlock();
+
+        // only the newest frame is sent, anything published in between is dropped
+        front_idx = pending.exchange(front_idx) & FRAME_SLOT_MASK;
+        const LEDArray& frame = frames[front_idx];
+        const LEDArray& input = frame_inputs[front_idx];
+        const uint32_t gen = frame_gens[front_idx];
+        // same input through the same output settings only differs by its dither phase
+        bool unchanged = have_last_sent
+            && ((gen == last_sent_gen && std::memcmp(input.data(), last_sent_input.data(), sizeof(LEDArray)) == 0)
+                || std::memcmp(frame.data(), last_sent.data(), sizeof(LEDArray)) == 0);
+        if (unchanged && (keep_alive <= 0 || FrameClock::now_ns() - last_sent_ns < keep_alive * 1000000ll)) {
+            skipped_frames.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            transmit(frame);
+            last_sent_input = input;
+            last_sent_gen = gen;
+        }
 
+        lock.lock();
+    }
+}
+
+void LEDManager::transmit(const LEDArray& frame) {
+    bool hit = false;
+    char* tx = cached_tx(frame, hit);
+    if (!tx) tx = transport->next_tx();
+    if (!hit) {
+        StageTimer t(stage(FrameStage::Encode));
+        encode_frame(frame, tx);
+    } else {
+        tx_cache_hits.fetch_add(1, std::memory_order_relaxed);
+    }
+    bool sent;
+    {
+        StageTimer t(stage(FrameStage::Transfer));
+        sent = transport->transfer(tx, transport->tx_len);
+    }
+    // once per run of failures, a sink that lost its reader fails every frame
+    if (!sent && !transfer_failing) {
+        std::cerr << "[LEDManager] " << transport->name() << " transfer failed." << std::endl;
+    }
+    transfer_failing = !sent;
+    frames_transmitted.fetch_add(1, std::memory_order_relaxed);
+    if (&frame != &last_sent) last_sent = frame;
+    have_last_sent = true;
+    last_sent_ns = FrameClock::now_ns();
+}
+
+char* LEDManager::cached_tx(const LEDArray& frame, bool& hit) {
+    size_t budget = tx_cache_budget.load(std::memory_order_relaxed);
+    if (budget != tx_cache_size) {
+        tx_cache_size = budget;
+        if (budget == 0) tx_cache->Release();
+        else tx_cache->Configure(transport->tx_len, budget);
+    }
+    if (!tx_cache->Enabled()) return nullptr;
+    return tx_cache->Get(frame, output.Generation(), hit);
+}
+
+} // namespace tfw
@@ -1,19 +1,29 @@
 #pragma once
 
 #include "led_color.h"
+#include "frame_clock.h"
+#include "frame_stats.h"
+#include "led_output.h"
+#include "led_render.h"
+#include "led_clock.h"
 #include <memory>
+#include <array>
 #include <vector>
 #include <thread>
 #include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <functional>
+#include <cstddef>
 
 // Forward declarations
-class spi_t;
-class LEDMatrix;
+struct led_transport_t;
 class Animatable;
-
-namespace tfw {
-    class RotatingOrbAnimator; // Forward declaration
-}
+class LEDCompositor;
+class LEDFrameCache;
+class LEDTxCache;
+enum class BlendMode : uint8_t;
 
 namespace tfw {
 
@@ -21,28 +31,223 @@ class LEDManager {
 public:
     explicit LEDManager();
     ~LEDManager();
-    
-    // Initializes the SPI hardware. Returns false on failure.
+
+    // Initializes the SPI hardware and starts the output thread. Returns false on failure.
     bool Initialize();
+    // Same, but drives the given transport (e.g. a sink from led_sinks.h) instead of SPI.
+    bool Initialize(std::unique_ptr<led_transport_t> transport);
+
+    // Fills a whole frame for time t, linear colours (the output stage
+    // calibrates them). Empty means black.
+    using frame_source_fn = std::function<void(render_time_t t, led_span_t out)>;
 
-    // Plays a given animation for a specified duration.
+    // Plays a given animation for a specified duration (in Clock() time).
+    // Stops the render thread first. Show() calls from other threads while it
+    // plays are held back and start the render thread once it returns.
     void PlayAnimation(Animatable& animation, int duration_seconds);
-    
-    // Overload for RotatingOrbAnimator which uses a different interface
-    void PlayAnimation(RotatingOrbAnimator& animation, int duration_seconds);
 
-    // Turns all LEDs off.
+    // Renders and publishes the animation's frame for time t without pacing.
+    // Not while the render thread is running (Show()), it refuses then; call
+    // StopRendering() first. Show() calls meanwhile are held back like during
+    // PlayAnimation().
+    void RenderFrame(Animatable& animation, render_time_t t);
+    void RenderFrame(Animatable& animation) { RenderFrame(animation, Now()); }
+
+    // Where render time comes from (led_clock.h), RealClock by default. A
+    // ManualClock with a step renders frames back to back, deterministic and
+    // faster than realtime. nullptr goes back to the real clock. Only set it
+    // while the render thread is stopped.
+    void SetClock(std::shared_ptr<AnimationClock> c) { clock = c ? std::move(c) : std::make_shared<RealClock>(); }
+    AnimationClock& Clock() const { return *clock; }
+    // Any thread.
+    render_time_t Now() const { return clock->Now(); }
+    int64_t NowNs() const { return clock->NowNs(); }
+
+    // Non-blocking: switches the render thread over to `animation`, cross-fading
+    // from whatever is on the strip for `fade` (0 = hard cut). Returns right away,
+    // the switch happens at the start of the next frame. nullptr fades to black.
+    // Starts the render thread on first use.
+    void Show(std::shared_ptr<Animatable> animation,
+              std::chrono::milliseconds fade = std::chrono::milliseconds(0),
+              EaseCurve curve = EaseCurve::InOut);
+    void Show(std::nullptr_t,
+              std::chrono::milliseconds fade = std::chrono::milliseconds(0),
+              EaseCurve curve = EaseCurve::InOut) { post_show(nullptr, fade, curve); }
+    // Blends `source` on top of everything Show() puts out, e.g. frames from
+    // another process (led_shm.h). Black is transparent in BlendMode::Alpha.
+    // Empty source removes the overlay. Picked up on the next frame.
+    void SetOverlay(frame_source_fn source, BlendMode mode, float opacity = 1.0f);
+
+    // Called by the render thread at the top of every frame with the frame's
+    // Clock() time, before it picks up Show() requests (so a Show() from the
+    // hook lands on that same frame).
+    // Only set it while the render thread is stopped.
+    void SetFrameHook(std::function<void(int64_t now_ns)> hook) { frame_hook = std::move(hook); }
+    // Renders the next frame right away instead of at the next deadline (at
+    // most one early frame per ms). Any thread, Show() does it implicitly.
+    void RequestFrame() { FrameClock::Wake(render_wake); }
+    // True while a cross-fade is queued or running.
+    bool InTransition() const { return in_transition.load(std::memory_order_relaxed); }
+    // Stops the render thread, the strip keeps its last frame. PlayAnimation()
+    // calls this and keeps Show() from restarting it until it's done, so the
+    // blocking and threaded paths never run at the same time.
+    void StopRendering();
+
+    // Periodic animations given to Show() are baked into a looping frame table
+    // once and played back from it (led_frame_cache.h). Takes effect on the
+    // next Show().
+    void SetFrameCache(bool enabled) { frame_cache_enabled.store(enabled, std::memory_order_relaxed); }
+    // Memory for fully encoded transmit buffers (led_tx_cache.h), 0 = off.
+    // Repeating frames then skip the encoder, dithered or not (the dither
+    // repeats every LED_DITHER_PERIOD frames). Baked animations then play
+    // exact table frames, but only when their table has a frame for every
+    // output frame at TargetFps(), slower cycles keep blending. Any thread.
+    void SetTxCacheBudget(size_t bytes) { tx_cache_budget.store(bytes, std::memory_order_relaxed); }
+
+    // Per-ring gains, gamma and dithering applied to every published frame.
+    // Its setters are safe from any thread.
+    LEDOutputStage& Output() { return output; }
+
+    // Stops the render thread (StopRendering()) and turns all LEDs off. Not
+    // from the frame hook.
     void Clear();
 
+    // Frame rate PlayAnimation paces itself to (default 50).
+    void SetTargetFps(uint32_t fps) { frame_clock.SetFps(fps); }
+    uint32_t TargetFps() const { return frame_clock.Fps(); }
+    // Deadlines missed since Initialize().
+    uint64_t MissedDeadlines() const { return frame_clock.MissedDeadlines(); }
+
+    // Frames identical to the last one sent are not re-encoded or transmitted,
+    // compared before the output stage: with dithering on (the default) a
+    // still frame would otherwise differ on every phase and never be skipped.
+    // The trade-off is that a still frame stays on the strip at one dither
+    // phase, so temporal dithering only smooths frames that change. The last
+    // frame is still re-sent at least this often (0 = never).
+    void SetKeepAlive(std::chrono::milliseconds interval) { keep_alive_ms.store(interval.count()); }
+    // Frames dropped because nothing changed (same input and output settings,
+    // or the same calibrated frame).
+    uint64_t SkippedFrames() const { return skipped_frames.load(std::memory_order_relaxed); }
+
+    // Per-stage timing histograms and frame counters since Initialize()/ResetStats().
+    FrameStatsSnapshot Stats() const;
+    void ResetStats();
+    void SetStatsEnabled(bool enabled) { stats_enabled.store(enabled, std::memory_order_relaxed); }
+    // Prints Stats() every `interval` while animations play (0 = off).
+    void SetStatsDumpInterval(std::chrono::seconds interval) { stats_dump_interval_s.store(interval.count()); }
+    // Async-signal-safe: the stats get printed on the next frame (hook it to SIGUSR1).
+    static void RequestStatsDump() { stats_dump_requested.store(true, std::memory_order_relaxed); }
+
 private:
-    friend class RotatingOrbAnimator; // Animator needs access to update_leds
+    // Frame being composed by the render side.
+    LEDArray& back_frame() { return frames[back_idx]; }
+    // Hands the back frame to the output thread and takes a free slot in exchange.
     void update_leds();
 
-    std::unique_ptr<spi_t> spi;
+    void output_loop();
+    void post_show(frame_source_fn source, std::chrono::milliseconds fade, EaseCurve curve);
+    // PlayAnimation()/RenderFrame() own back_frame() between these two. false if
+    // another one does, or (unless render_thread_ok) the render thread runs.
+    bool begin_blocking(const char* who, bool render_thread_ok);
+    // lets a Show() that came in meanwhile start the render thread
+    void end_blocking();
+    void render_frame(Animatable& animation, render_time_t t);
+    void render_loop();
+    void render_transition(LEDArray& out, render_time_t t);
+    void transmit(const LEDArray& frame);
+    // Output thread. Cache buffer for `frame`, nullptr when the cache is off.
+    char* cached_tx(const LEDArray& frame, bool& hit);
+    // Logs deadlines missed since `missed_before`.
+    void report_missed(uint64_t missed_before);
+    // Prints the stats if a dump was requested or the dump interval passed.
+    void maybe_dump_stats();
+    LatencyHistogram* stage(FrameStage s) {
+        return stats_enabled.load(std::memory_order_relaxed) ? &stage_hist[static_cast<int>(s)] : nullptr;
+    }
+
+    std::unique_ptr<led_transport_t> transport;
     bool functional = false;
-    
-    std::array<led_color_t, LED_COUNT> leds;
-    std::unique_ptr<LEDMatrix> matrix;
+
+    // Frame hand-off between the render side and the output thread.
+    // The render side owns frames[back_idx], the output thread owns frames[front_idx];
+    // the third slot sits in `pending` so a publish is a single atomic exchange and
+    // neither side ever waits for the other to finish with a buffer.
+    static constexpr uint8_t FRAME_SLOT_MASK = 0x3;
+    static constexpr uint8_t FRAME_FRESH     = 0x4;
+    std::array<LEDArray, 3> frames{};
+    // what each slot's frame was before the output stage, and the stage's
+    // generation, so an unchanged frame is caught even though its dither moved
+    std::array<LEDArray, 3> frame_inputs{};
+    std::array<uint32_t, 3> frame_gens{};
+    uint8_t back_idx  = 0;
+    uint8_t front_idx = 1;
+    std::atomic<uint8_t> pending{2};
+
+    // Output thread owns the transport once Initialize() succeeds.
+    std::thread output_thread;
+    std::mutex output_mutex;              // only guards the wakeup, never the frame data
+    std::condition_variable output_cv;
+    bool output_running = false;
+
+    // Dirty-frame tracking (output thread only, apart from the atomics).
+    LEDArray last_sent{};
+    LEDArray last_sent_input{};           // its frame_inputs / frame_gens entry
+    uint32_t last_sent_gen = 0;
+    bool have_last_sent = false;
+    int64_t last_sent_ns = 0;
+    std::atomic<int64_t> keep_alive_ms{1000};
+    std::atomic<uint64_t> skipped_frames{0};
+    bool transfer_failing = false;
+    std::unique_ptr<LEDTxCache> tx_cache;         // output thread only
+    std::atomic<size_t> tx_cache_budget;
+    size_t tx_cache_size = 0;                     // budget it was built for
+    std::atomic<uint64_t> tx_cache_hits{0};
+
+    FrameClock frame_clock;
+    std::shared_ptr<AnimationClock> clock = std::make_shared<RealClock>();
+    LEDOutputStage output;                // render side only, apart from its setters
+
+    // Render thread. Show() only parks the request in show_request, the
+    // render thread picks it up at the top of its next frame.
+    struct show_request_t {
+        frame_source_fn source;
+        int64_t fade_ns = 0;
+        EaseCurve curve = EaseCurve::InOut;
+    };
+    std::thread render_thread;
+    std::atomic<bool> render_running{false};
+    std::atomic<uint32_t> render_wake{0};
+    std::mutex show_mutex;                // guards the show/overlay requests and blocking_playback
+    show_request_t show_request;
+    bool show_pending = false;
+    bool blocking_playback = false;       // PlayAnimation()/RenderFrame() running, Show() won't start the thread
+    std::unique_ptr<LEDCompositor> overlay_request;   // guarded by show_mutex
+    bool overlay_pending = false;
+    std::atomic<bool> in_transition{false};
+    std::function<void(int64_t)> frame_hook;
+    // render thread only
+    frame_source_fn current_source;       // what's on the strip, or fading in
+    frame_source_fn fade_source;          // fading out (empty = black)
+    LEDArray fade_from{};                 // its frame, frozen if a fade got interrupted
+    bool fade_frozen = false;
+    int64_t fade_start_ns = 0;
+    int64_t fade_ns = 0;
+    EaseCurve fade_curve = EaseCurve::InOut;
+    LEDArray last_rendered{};
+    std::unique_ptr<LEDCompositor> overlay;   // Show() output + overlay layer
+    LEDArray overlay_base{};
+    std::unique_ptr<LEDFrameCache> frame_cache;   // baked tables, render thread only
+    std::atomic<bool> frame_cache_enabled{true};
+
+    // Frame timing
+    std::array<LatencyHistogram, static_cast<int>(FrameStage::Count)> stage_hist;
+    std::atomic<bool> stats_enabled{true};
+    std::atomic<uint64_t> frames_published{0};
+    std::atomic<uint64_t> frames_transmitted{0};
+    int64_t last_publish_ns = 0;                  // render side only
+    int64_t last_stats_dump_ns = 0;               // render side only
+    std::atomic<int64_t> stats_dump_interval_s{0};
+    static std::atomic<bool> stats_dump_requested;
 };
 
-} 
\ No newline at end of file
+}
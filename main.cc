@@ -1,10 +1,19 @@
 #include "ledmgr.h"
 #include "led_matrix.h"
 #include "rotating_orb_anim.h"
+#include "led_compositor.h"
+#include "led_state_machine.h"
+#include "led_control.h"
+#include "led_shm.h"
+#include "led_sinks.h"
 #include <iostream>
 #include <memory>
 #include <csignal>
 #include <atomic>
+#include <cstdlib>
+#include <thread>
+#include <chrono>
+#include <cstring>
 
 static std::atomic<bool> keep_running(true);
 
@@ -12,80 +21,130 @@ static void signal_handler(int){
     keep_running.store(false);
 }
 
-int main() {
+int main(int argc, char** argv) {
     // keot this here just in case
     using namespace tfw;
 
+    // ctrl-c, or systemd / kill stopping the daemon: clear the strip and unlink the socket on the way out
     std::signal(SIGINT, signal_handler);
+    std::signal(SIGTERM, signal_handler);
+    // kill -USR1 <pid> prints frame timing stats
+    std::signal(SIGUSR1, [](int){ LEDManager::RequestStatsDump(); });
+    // a LED_SINK FIFO whose reader exits must fail the write (EPIPE), not kill us
+    std::signal(SIGPIPE, SIG_IGN);
 
     std::cout << "--- LED Animation Demo ---" << std::endl;
 
     // 1. Initialize the LED Manager
+    // LED_SINK=<path> writes decoded rgb frames to a file/FIFO instead of the SPI device
     auto led_manager = std::make_unique<LEDManager>();
-    if (!led_manager->Initialize()) {
+    const char* sink_path = std::getenv("LED_SINK");
+    bool initialized = sink_path ? led_manager->Initialize(std::make_unique<file_sink_t>(sink_path))
+                                 : led_manager->Initialize();
+    if (!initialized) {
         std::cerr << "Fatal: Could not initialize LED Manager. Exiting." << std::endl;
         return 1;
     }
-// IDLE blue glow (ready to start a task)
-    while(keep_running.load()){
-
-        // "Loader" - Green Loader (TODO: make this smoother so make the les light up with a gausssiamn effect so its smoother)
-        Loader loader_animation({20, 150, 40}, 3000);
-        const int loader_duration_s = 5;
-        std::cout << "\nPlaying LOADER animation for " << loader_duration_s << " seconds..." << std::endl;
-        led_manager->PlayAnimation(loader_animation, loader_duration_s);
-
-        // "Connect to me!" - Orange orb with black background 
-        RotatingOrbAnimator connect_to_me_animation({30.0f, 1.0f, 1.0f}, {0, 0, 0});
-        const int connect_to_me_duration_s = 5;
-        std::cout << "\nPlaying CONNECT_TO_ME animation for " << connect_to_me_duration_s << " seconds..." << std::endl;
-        led_manager->PlayAnimation(connect_to_me_animation, connect_to_me_duration_s);
-
-        // connecting, black orb with white background
-        RotatingOrbAnimator connecting_animation({0.0f, 0.0f, 0.0f}, {255, 255, 255});
-        const int connecting_duration_s = 5;
-        std::cout << "\nPlaying CONNECTING animation for " << connecting_duration_s << " seconds..." << std::endl;
-        led_manager->PlayAnimation(connecting_animation, connecting_duration_s);
-
-        // "connected! - blue orb with black background"
-        RotatingOrbAnimator connected_animation({240.0f, 1.0f, 1.0f}, {0, 0, 0});
-        const int connected_duration_s = 5;
-        std::cout << "\nPlaying CONNECTED animation for " << connected_duration_s << " seconds..." << std::endl;
-        led_manager->PlayAnimation(connected_animation, connected_duration_s);
-
-        Glow idle_animation(5, led_color_t{40, 120, 255}, led_color_t{5,5,10});
-        const int idle_duration_s = 5;
-        std::cout << "\nPlaying IDLE animation for " << idle_duration_s << " seconds..." << std::endl;
-        led_manager->PlayAnimation(idle_animation, idle_duration_s);
-
-        // "Respond to User" - Orange Glow 
-        Glow respond_animation(5, {255, 140, 0}, {10, 5, 0});
-        const int respond_duration_s = 5;
-        std::cout << "\nPlaying RESPOND_TO_USER animation for " << respond_duration_s << " seconds..." << std::endl;
-        led_manager->PlayAnimation(respond_animation, respond_duration_s);
-
-        // "Error" - Red Glow
-        Glow error_animation(5, {255, 0, 0}, {25, 5, 5});
-        const int error_duration_s = 5;
-        std::cout << "\nPlaying ERROR animation for " << error_duration_s << " seconds..." << std::endl;
-        led_manager->PlayAnimation(error_animation, error_duration_s);
-
-        // "Reasoning" - White orb with grey background when models thinking (user hits enter)
-        RotatingOrbAnimator reasoning_animation({0.0f, 0.0f, 1.0f}, {128, 128, 128});
-        const int reasoning_duration_s = 5;
-        std::cout << "\nPlaying REASONING animation for " << reasoning_duration_s << " seconds..." << std::endl;
-        led_manager->PlayAnimation(reasoning_animation, reasoning_duration_s);
-
+    // LED_STATS_INTERVAL=<seconds> prints frame timing stats periodically
+    if (const char* stats_interval = std::getenv("LED_STATS_INTERVAL")) {
+        led_manager->SetStatsDumpInterval(std::chrono::seconds(std::atoi(stats_interval)));
+    }
+    // LED_TIME_SCALE=<rate> plays every animation, fade and timeout at that speed (0.25 = slow motion)
+    if (const char* time_scale = std::getenv("LED_TIME_SCALE")) {
+        led_manager->SetClock(std::make_shared<ScaledClock>(std::strtof(time_scale, nullptr)));
+    }
+    // the state machine owns the render thread, SetState() returns right away
+    // and the next frame cross-fades into whatever state wins
+    LEDStateMachine states(*led_manager);
+    states.SetFade(std::chrono::milliseconds(400));
+    states.Start();
+
+    // --daemon [socket]: no demo, other processes drive the states (see led_ctl)
+    if (argc > 1 && std::strcmp(argv[1], "--daemon") == 0) {
+        // LED_SHM=<name> (or 1 for the default) lets other processes stream frames
+        // into a shared memory ring, drawn on top of the current state
+        auto shm = std::make_shared<LEDShmConsumer>();
+        if (const char* shm_name = std::getenv("LED_SHM")) {
+            if (shm->Open(std::strcmp(shm_name, "1") == 0 ? LED_SHM_DEFAULT_NAME : shm_name)) {
+                led_manager->SetOverlay([shm](render_time_t, led_span_t out) {
+                    LEDArray frame;
+                    if (shm->Latest(frame)) out.copy_from(frame);
+                    else out.fill({0, 0, 0});
+                }, BlendMode::Alpha);
+            }
+        }
+
+        LEDControlServer server(*led_manager, states);
+        if (!server.Start(argc > 2 ? argv[2] : LED_CONTROL_DEFAULT_SOCKET)) {
+            std::cerr << "Fatal: Could not start the control socket. Exiting." << std::endl;
+            return 1;
+        }
+        // state changes get logged from here, the render thread doesn't print
+        uint64_t transitions = 0;
+        while (keep_running.load()) {
+            uint64_t now_transitions = states.Transitions();
+            if (now_transitions != transitions) {
+                printf("[LEDState] -> %s \n", led_state_name(states.State()));
+                transitions = now_transitions;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        server.Stop();
+        states.SetState(LEDState::Off);
+        std::this_thread::sleep_for(std::chrono::milliseconds(450));
+        states.Stop();
+        if (shm->ok()) {
+            printf("[LEDShm] frames %llu, torn %llu, stale %llu \n",
+                   static_cast<unsigned long long>(shm->Frames()), static_cast<unsigned long long>(shm->TornFrames()),
+                   static_cast<unsigned long long>(shm->StaleFrames()));
+            shm->Unlink();
+        }
+        std::cout << "\nDaemon stopped. Cleaning up." << std::endl;
+        led_manager->Clear();
+        return 0;
+    }
 
+    auto hold = [](int ms) {
+        auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+        while (keep_running.load() && std::chrono::steady_clock::now() < until)
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    };
+    auto enter = [&](LEDState state, int seconds, LEDStateParams params = {}) {
+        std::cout << "\nState " << led_state_name(state) << " for " << seconds << " seconds..." << std::endl;
+        states.SetState(state, params);
+        hold(seconds * 1000);
+    };
 
-        // "Typing" - Blue orb with pearly background (can tune colors and speed) wanna use for user typing, spins faster as they typew faster (use classification requests as metric?)
-        RotatingOrbAnimator typing_animation({240.0f, 1.0f, 1.0f}, {200, 200, 220}, 90.0f);
-        std::cout << "\nPlaying TYPING animation: 10s slow, 10s fast..." << std::endl;
-        led_manager->PlayAnimation(typing_animation, 5);
-        typing_animation.setRotationSpeed(300.0f);
-        led_manager->PlayAnimation(typing_animation, 5);
+// IDLE blue glow (ready to start a task)
+    while(keep_running.load()){
+        enter(LEDState::Idle, 5);
+        // loading outranks the connection states, it has to be cleared once done
+        enter(LEDState::Loading, 5);
+        states.ClearState(LEDState::Loading);
+        enter(LEDState::ConnectToMe, 5);
+        enter(LEDState::Connecting, 5);
+        // connected falls back to idle on its own after 3s
+        enter(LEDState::Connected, 5);
+        enter(LEDState::Respond, 5);
+        enter(LEDState::Reasoning, 5);
+        states.ClearState(LEDState::Reasoning);
+
+        // "Typing" - spins faster as they type faster, every keystroke renews
+        // the claim and typing drops back to idle 2s after the last one
+        std::cout << "\nState typing: slow, fast, then an error on top..." << std::endl;
+        for (int i = 0; i < 120 && keep_running.load(); ++i) {
+            states.Keystroke();
+            if (i == 100) states.SetState(LEDState::Error);   // error wins over typing, goes away after 5s
+            hold(i < 20 ? 300 : 60 + (i * 37) % 50);          // ~3 keys/s, then a ~12 keys/s burst
+        }
+        hold(3000);
     }
 
+    // fade out before the manager blanks the strip
+    states.SetState(LEDState::Off);
+    std::this_thread::sleep_for(std::chrono::milliseconds(450));
+    states.Stop();
+
     std::cout << "\nDemo finished. Cleaning up." << std::endl;
     led_manager->Clear();
 
@@ -3,6 +3,7 @@
 #include <stdlib.h>
 #include <cstring>
 #include <cstdio>
+#include <cerrno>
 #include <unistd.h>
 #include <sys/fcntl.h>
 #include <sys/mman.h>
@@ -17,6 +18,8 @@
 #include <linux/types.h>
 #include <linux/gpio.h>
 
+#include "led_transport.h"
+
 /*
 this is basically just catered to our use case 
 impl. is ripped from jetgpio
@@ -51,7 +54,7 @@ enum spi_state : int {
 
 
 
-struct spi_t{
+struct spi_t : led_transport_t {
     int32_t fd;
     uint32_t speed;
     spi_state state;
@@ -99,7 +102,12 @@ struct spi_t{
         state = SPI_OPEN;
         printf("[SPI] Opened '%s' @ %.3f Mbits/s \n", SPI_DEV, (float)speed / (float)1000000.f);
     }
-    bool transfer(char* tx_buffer, uint32_t len, char* rx_buffer = nullptr){
+    bool ok() const override { return state == SPI_OPEN; }
+    const char* name() const override { return "SPI"; }
+    bool transfer(char* tx_buffer, uint32_t len) override {
+        return transfer(tx_buffer, len, nullptr);
+    }
+    bool transfer(char* tx_buffer, uint32_t len, char* rx_buffer){
         spi_ioc_transfer tr = {
             .tx_buf = (uintptr_t)tx_buffer,
             .rx_buf = (uintptr_t)rx_buffer,